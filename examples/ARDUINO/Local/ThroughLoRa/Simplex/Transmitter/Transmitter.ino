@@ -34,6 +34,6 @@ void setup() {
 void loop() {
 	bus.update();
 
-	if (!bus.packets[packet].state)
+	if (!bus.get_packet_state(packet))
 		packet = bus.send(44, content, 20);
 };
@@ -0,0 +1,46 @@
+/* CRC32 implementations throughput comparison for packet lengths from 16B
+   to 64kB. PJON_CRC32_HARDWARE is selected so all the implementations are
+   included, hardware support is checked at runtime and reported. */
+
+#define PJON_INCLUDE_NONE
+#define PJON_CRC32_MODE PJON_CRC32_HARDWARE
+#include <PJON.h>
+
+typedef uint32_t (* crc32_update)(uint32_t, const uint8_t *, uint16_t);
+
+const uint32_t sizes[] = { 16, 64, 256, 1024, 4096, 16384, 65535 };
+uint8_t buffer[65535];
+volatile uint32_t sink = 0;
+
+double throughput(crc32_update update, uint16_t length) {
+  // Process around 32MB per measurement
+  uint32_t iterations = (32ul * 1024 * 1024) / length;
+  auto start = std::chrono::high_resolution_clock::now();
+  for(uint32_t i = 0; i < iterations; i++)
+    sink += ~update(0xFFFFFFFF, buffer, length);
+  double seconds = std::chrono::duration<double>(
+    std::chrono::high_resolution_clock::now() - start
+  ).count();
+  return ((double)iterations * length) / seconds / (1024 * 1024);
+};
+
+int main() {
+  for(uint32_t i = 0; i < sizeof(buffer); i++) buffer[i] = PJON_RANDOM(255);
+  printf(
+    "Hardware CRC32 %s\n",
+    PJON_crc32::hardware_available() ? "available" : "not available"
+  );
+  printf("Length    Bitwise    Table  Slice-by-8  Hardware   (MB/s)\n");
+  for(uint8_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    uint16_t length = sizes[s];
+    printf(
+      "%6u %10.1f %8.1f %11.1f %9.1f\n",
+      length,
+      throughput(PJON_crc32::update_bitwise, length),
+      throughput(PJON_crc32::update_table, length),
+      throughput(PJON_crc32::update_slice_by_8, length),
+      throughput(PJON_crc32::update_hardware, length)
+    );
+  }
+  return 0;
+};
@@ -0,0 +1,128 @@
+/* Router with 8 GlobalUDP buses on 127.0.0.1, each replying to the packets
+   it receives. The buses are first served polling them in turn, as
+   PJONSimpleSwitch::loop does, then with PJON_Reactor. A client sends
+   packets to the buses in turn and measures the time until the reply is
+   received, the CPU time and the system calls (socket and epoll calls) made
+   by the router for each reply are measured too. */
+
+#define PJON_INCLUDE_GUDP
+#include <PJON.h>
+#include <interfaces/LINUX/PJON_LINUX_Reactor.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define BUSES         8
+#define ROUTER_PORT   7600
+#define CLIENT_PORT   7700
+#define CLIENT_ID     2
+#define DURATION      2000000 // Microseconds the router runs
+
+uint8_t localhost_ip[] = { 127, 0, 0, 1 };
+bool replied = false;
+uint32_t replies = 0;
+int results[2]; // Pipe where the router writes its syscalls per reply
+
+void router_receiver(uint8_t *payload, uint16_t length, const PJON_Packet_Info &info) {
+  ((PJON<GlobalUDP> *)info.custom_pointer)->reply((const char *)payload, length);
+  replies++;
+}
+
+void client_receiver(uint8_t *payload, uint16_t length, const PJON_Packet_Info &info) {
+  replied = true;
+}
+
+void router(bool use_reactor) {
+  PJON<GlobalUDP> buses[BUSES];
+  PJON_Reactor reactor;
+  for(uint8_t i = 0; i < BUSES; i++) {
+    buses[i].set_id(10 + i);
+    buses[i].strategy.set_port(ROUTER_PORT + i);
+    buses[i].strategy.add_node(CLIENT_ID, localhost_ip, CLIENT_PORT);
+    buses[i].set_synchronous_acknowledge(false);
+    buses[i].set_custom_pointer(&buses[i]);
+    buses[i].set_receiver(router_receiver);
+    buses[i].begin();
+    if(use_reactor) reactor.add(buses[i]);
+  }
+  uint32_t start = PJON_MICROS();
+  while((uint32_t)(PJON_MICROS() - start) < DURATION) {
+    if(use_reactor) reactor.loop(100000);
+    else {
+      for(uint8_t i = 0; i < BUSES; i++) buses[i].receive(1000);
+      for(uint8_t i = 0; i < BUSES; i++) buses[i].update();
+    }
+  }
+  uint32_t syscalls = reactor.get_syscall_count();
+  for(uint8_t i = 0; i < BUSES; i++)
+    syscalls += buses[i].strategy.get_syscall_count();
+  double per_reply = replies ? (double)syscalls / replies : 0;
+  if(write(results[1], &per_reply, sizeof(per_reply)) != sizeof(per_reply))
+    printf("Unable to report the system calls\n");
+}
+
+void client(const char *name) {
+  PJON<GlobalUDP> bus(CLIENT_ID);
+  bus.strategy.set_port(CLIENT_PORT);
+  for(uint8_t i = 0; i < BUSES; i++)
+    bus.strategy.add_node(10 + i, localhost_ip, ROUTER_PORT + i);
+  bus.set_synchronous_acknowledge(false);
+  bus.set_receiver(client_receiver);
+  bus.begin();
+  PJON_DELAY(200); // Let the router start
+  char packet[] = "P";
+  uint32_t count = 0, lost = 0, total = 0, worst = 0;
+  uint32_t start = PJON_MICROS();
+  while((uint32_t)(PJON_MICROS() - start) < DURATION - 500000) {
+    replied = false;
+    uint32_t sent = PJON_MICROS();
+    bus.send_packet(10 + (count + lost) % BUSES, packet, 1);
+    while(!replied && (uint32_t)(PJON_MICROS() - sent) < 50000) bus.receive();
+    uint32_t time = PJON_MICROS() - sent;
+    if(!replied) { lost++; continue; }
+    count++;
+    total += time;
+    if(time > worst) worst = time;
+  }
+  int status;
+  wait(&status);
+  struct rusage usage;
+  getrusage(RUSAGE_CHILDREN, &usage);
+  static double previous = 0;
+  double cpu = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+    (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+  double per_reply = 0;
+  if(read(results[0], &per_reply, sizeof(per_reply)) != sizeof(per_reply))
+    per_reply = 0;
+  printf(
+    "%-8s %10.1f %12u %12u %8u %5u %16.2f\n",
+    name,
+    100 * (cpu - previous) / (DURATION / 1000000.0),
+    count ? total / count : 0,
+    worst,
+    count,
+    lost,
+    per_reply
+  );
+  previous = cpu;
+}
+
+int main() {
+  if(pipe(results) == -1) {
+    printf("Unable to open the pipe\n");
+    return 1;
+  }
+  printf(
+    "Mode     Router CPU %%  RTT avg us   RTT max us  Replies  Lost"
+    "  Syscalls/reply\n"
+  );
+  const char *names[] = { "Polling", "Reactor" };
+  for(uint8_t mode = 0; mode < 2; mode++) {
+    fflush(stdout);
+    if(fork() == 0) {
+      router(mode);
+      return 0;
+    }
+    client(names[mode]);
+  }
+  return 0;
+};
@@ -0,0 +1,199 @@
+/* ThroughSerial throughput through a pseudo terminal.
+
+   Reception: a thread writes frames to the master side as fast as the pty
+   accepts them, the receiver opens the slave side with serialOpen and
+   receives with PJON. BenchmarkUnbuffered is built with
+   PJON_SERIAL_BUFFER_LENGTH 0, so that each byte is read with its own
+   system calls.
+
+   Transmission: ThroughSerial::send_string writes frames to the slave side
+   while a thread reads the master side, it is compared with writing one
+   byte at a time. */
+
+#define PJON_INCLUDE_TS
+#define PJON_PACKET_MAX_LENGTH 255
+#include <PJON.h>
+#include <atomic>
+#include <poll.h>
+#include <sys/resource.h>
+
+const uint8_t sizes[] = { 16, 64, 200 };
+const uint16_t frames_per_write = 64;
+uint8_t stream[frames_per_write * 2 * PJON_PACKET_MAX_LENGTH];
+uint32_t stream_length = 0;
+std::atomic<bool> writing;
+uint32_t received = 0;
+
+PJON<ThroughSerial> bus(44);
+
+void receiver_function(
+  uint8_t *payload,
+  uint16_t length,
+  const PJON_Packet_Info &info
+) {
+  received++;
+};
+
+/* Compose a frame as ThroughSerial would transmit it, byte-stuffing
+   included, and append it to the stream: */
+
+void append_frame(const uint8_t *packet, uint16_t length) {
+  stream[stream_length++] = TS_START;
+  for(uint16_t b = 0; b < length; b++) {
+    if(packet[b] == TS_START || packet[b] == TS_ESC || packet[b] == TS_END) {
+      stream[stream_length++] = TS_ESC;
+      stream[stream_length++] = packet[b] ^ TS_ESC;
+    } else stream[stream_length++] = packet[b];
+  }
+  stream[stream_length++] = TS_END;
+};
+
+void writer(int master) {
+  while(writing) {
+    uint32_t sent = 0;
+    while(writing && sent < stream_length) {
+      ssize_t result = write(master, stream + sent, stream_length - sent);
+      if(result > 0) sent += result;
+      else {
+        // Wait until the receiver makes room, or the test ends
+        struct pollfd fd = { master, POLLOUT, 0 };
+        poll(&fd, 1, 10);
+      }
+    }
+  }
+};
+
+std::atomic<uint32_t> read_bytes;
+
+void reader(int master) {
+  uint8_t buffer[4096];
+  while(writing) {
+    ssize_t result = read(master, buffer, sizeof(buffer));
+    if(result > 0) read_bytes += result;
+    else {
+      struct pollfd fd = { master, POLLIN, 0 };
+      poll(&fd, 1, 10);
+    }
+  }
+};
+
+/* The same frame written one byte at a time: */
+
+void send_bytewise(int fd, const uint8_t *packet, uint8_t length) {
+  uint8_t b = TS_START;
+  PJON_SERIAL_WRITE(fd, b);
+  for(uint8_t i = 0; i < length; i++) {
+    if(packet[i] == TS_START || packet[i] == TS_ESC || packet[i] == TS_END) {
+      b = TS_ESC;
+      PJON_SERIAL_WRITE(fd, b);
+      b = packet[i] ^ TS_ESC;
+    } else b = packet[i];
+    PJON_SERIAL_WRITE(fd, b);
+  }
+  b = TS_END;
+  PJON_SERIAL_WRITE(fd, b);
+  PJON_SERIAL_DRAIN(fd);
+};
+
+double cpu_seconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+    (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+};
+
+int main() {
+  int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if(master == -1 || grantpt(master) || unlockpt(master)) {
+    printf("Unable to open a pseudo terminal\n");
+    return 1;
+  }
+  struct termios config;
+  tcgetattr(master, &config);
+  cfmakeraw(&config);
+  tcsetattr(master, TCSANOW, &config);
+  int slave = serialOpen(ptsname(master), 4000000);
+  if(slave < 0) {
+    printf("Unable to open %s\n", ptsname(master));
+    return 1;
+  }
+  bus.strategy.set_serial(slave);
+  bus.set_receiver(receiver_function);
+  bus.begin();
+  printf("Buffer length %u\n", PJON_SERIAL_BUFFER_LENGTH);
+  printf("Payload    Packets/s     MB/s  CPU us/packet\n");
+  for(uint8_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    char payload[PJON_PACKET_MAX_LENGTH];
+    uint8_t packet[PJON_PACKET_MAX_LENGTH];
+    stream_length = 0;
+    for(uint16_t f = 0; f < frames_per_write; f++) {
+      for(uint8_t i = 0; i < sizes[s]; i++) payload[i] = PJON_RANDOM(255);
+      uint16_t length = bus.compose_packet(
+        44, bus.bus_id, (char *)packet, payload, sizes[s], PJON_TX_INFO_BIT
+      );
+      append_frame(packet, length);
+    }
+    received = 0;
+    writing = true;
+    std::thread thread(writer, master);
+    double cpu = cpu_seconds();
+    auto start = std::chrono::high_resolution_clock::now();
+    double seconds = 0;
+    while(seconds < 1) {
+      bus.receive();
+      seconds = std::chrono::duration<double>(
+        std::chrono::high_resolution_clock::now() - start
+      ).count();
+    }
+    cpu = cpu_seconds() - cpu;
+    writing = false;
+    thread.join();
+    printf(
+      "%7u %12.0f %8.2f %14.2f\n",
+      sizes[s],
+      received / seconds,
+      (double)received * sizes[s] / seconds / (1024 * 1024),
+      received ? cpu * 1000000 / received : 0
+    );
+    serialFlush(slave);
+  }
+  printf("\nPayload  Frame writes/s  Byte writes/s\n");
+  for(uint8_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    char payload[PJON_PACKET_MAX_LENGTH];
+    uint8_t packet[PJON_PACKET_MAX_LENGTH];
+    for(uint8_t i = 0; i < sizes[s]; i++) payload[i] = PJON_RANDOM(255);
+    uint16_t length = bus.compose_packet(
+      44, bus.bus_id, (char *)packet, payload, sizes[s], PJON_TX_INFO_BIT
+    );
+    stream_length = 0;
+    append_frame(packet, length);
+    double rate[2];
+    for(uint8_t mode = 0; mode < 2; mode++) {
+      read_bytes = 0;
+      writing = true;
+      std::thread thread(reader, master);
+      uint32_t sent = 0;
+      auto start = std::chrono::high_resolution_clock::now();
+      double seconds = 0;
+      while(seconds < 1) {
+        if(!mode) bus.strategy.send_string(packet, length);
+        else send_bytewise(slave, packet, length);
+        sent++;
+        seconds = std::chrono::duration<double>(
+          std::chrono::high_resolution_clock::now() - start
+        ).count();
+      }
+      // Let the reader receive what is left, then check nothing was lost
+      uint32_t expected = sent * stream_length;
+      for(uint8_t t = 0; t < 100 && read_bytes < expected; t++) delay(1);
+      writing = false;
+      thread.join();
+      if(read_bytes != expected) printf("Bytes lost in mode %u\n", mode);
+      rate[mode] = sent / seconds;
+    }
+    printf("%7u %15.0f %14.0f\n", sizes[s], rate[0], rate[1]);
+  }
+  serialClose(slave);
+  close(master);
+  return 0;
+};
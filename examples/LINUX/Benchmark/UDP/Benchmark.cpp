@@ -0,0 +1,59 @@
+/* UDPHelper loopback throughput, frames are sent in bursts from one socket
+   to another on 127.0.0.1 and received. Bursts are limited to around 200kB
+   so they fit the socket's receive buffer. Build with UDP_BATCH_SIZE greater
+   than 1 (BenchmarkBatched) to use recvmmsg and sendmmsg. */
+
+#define PJON_INCLUDE_GUDP
+#define PJON_PACKET_MAX_LENGTH 60100
+#include <PJON.h>
+
+const uint16_t sizes[] = { 50, 1024, 60000 };
+uint8_t localhost_ip[] = { 127, 0, 0, 1 };
+uint8_t frame[PJON_PACKET_MAX_LENGTH];
+UDPHelper sender, receiver;
+
+int main() {
+  sender.set_magic_header(htonl(GUDP_MAGIC_HEADER));
+  receiver.set_magic_header(htonl(GUDP_MAGIC_HEADER));
+  if(!sender.begin(7500) || !receiver.begin(7501)) {
+    printf("Unable to open the sockets\n");
+    return 1;
+  }
+  printf("Batch size %u\n", UDP_BATCH ? UDP_BATCH_SIZE : 1);
+  printf("Length    Frames/s     MB/s  Syscalls/frame  Lost\n");
+  for(uint8_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    uint16_t length = sizes[s];
+    uint8_t burst = 200000 / length > 32 ? 32 : 200000 / length;
+    for(uint16_t i = 0; i < length; i++) frame[i] = PJON_RANDOM(255);
+    uint32_t sent = 0, received = 0;
+    uint32_t syscalls =
+      sender.get_syscall_count() + receiver.get_syscall_count();
+    auto start = std::chrono::high_resolution_clock::now();
+    double seconds = 0;
+    while(seconds < 1) {
+      for(uint8_t b = 0; b < burst; b++)
+        sender.send_string(frame, length, localhost_ip, 7501);
+      sender.flush();
+      sent += burst;
+      for(uint8_t b = 0; b < burst; b++)
+        if(receiver.receive_string(frame, sizeof(frame)) == length) received++;
+        else break;
+      seconds = std::chrono::duration<double>(
+        std::chrono::high_resolution_clock::now() - start
+      ).count();
+    }
+    syscalls =
+      sender.get_syscall_count() + receiver.get_syscall_count() - syscalls;
+    printf(
+      "%6u %11.0f %8.1f %15.2f %5u\n",
+      length,
+      received / seconds,
+      (double)received * length / seconds / (1024 * 1024),
+      (double)syscalls / received,
+      sent - received
+    );
+    // Drain the frames left in the socket, if any
+    while(receiver.receive_string(frame, sizeof(frame)) != 0);
+  }
+  return 0;
+};
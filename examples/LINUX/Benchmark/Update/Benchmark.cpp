@@ -0,0 +1,92 @@
+/* Cost of update() with 256 packets in the buffer, per packet visited.
+   Busy: the medium is never free, each update visits all the packets and
+   counts an attempt for each. Repeated: packets are sent as often as
+   possible without acknowledgement. Idle: no packet is due, the time of
+   the whole update is reported. Buses use Null, a
+   strategy that does not transmit, and PJON reads a counter instead of the
+   clock, so that the time measured is spent in PJON. */
+
+#include <stdint.h>
+
+/* Each reading advances the time by a microsecond */
+uint32_t simulated_time = 0;
+uint32_t simulated_micros() { return ++simulated_time; };
+
+#define PJON_MICROS simulated_micros
+#define PJON_INCLUDE_NONE
+#include <PJON.h>
+
+struct Null {
+  bool free = false;
+  uint32_t sent = 0;
+
+  uint32_t back_off(uint8_t attempts) { return 0; };
+  bool begin(uint8_t additional_randomness = 0) { return true; };
+  bool can_start() { return free; };
+  static uint8_t get_max_attempts() { return 255; };
+  void handle_collision() { };
+  uint16_t receive_response() { return PJON_FAIL; };
+  uint16_t receive_string(uint8_t *string, uint16_t max_length) {
+    return PJON_FAIL;
+  };
+  void send_response(uint8_t response) { };
+  void send_string(uint8_t *string, uint16_t length) { sent++; };
+};
+
+const uint16_t slots = 256;
+const uint32_t updates = 2000;
+
+/* Returns the lowest average time in nanoseconds of an update of 5 runs: */
+
+template<class Bus>
+double measure(Bus &bus) {
+  double best = 0;
+  for(uint8_t run = 0; run < 5; run++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for(uint32_t i = 0; i < updates; i++) bus.update();
+    double seconds = std::chrono::duration<double>(
+      std::chrono::high_resolution_clock::now() - start
+    ).count();
+    if(!run || seconds < best) best = seconds;
+  }
+  return best * 1000000000 / updates;
+};
+
+template<uint16_t PacketMaxLength>
+void benchmark() {
+  static PJON<Null, slots, PacketMaxLength> bus(1);
+  bus.set_config_bit(false, PJON_ACK_REQ_BIT);
+  bus.begin();
+  char payload[16] = "Benchmark";
+  for(uint16_t i = 0; i < slots; i++)
+    if(bus.send_repeatedly(i % 200 + 2, payload, sizeof(payload), 1) ==
+      PJON_FAIL) printf("Buffer full\n");
+  bus.strategy.free = false;
+  double busy = measure(bus) / slots;
+  bus.strategy.free = true;
+  bus.strategy.sent = 0;
+  // Packets sent at the end of an update may be due only after the next one
+  double repeated = measure(bus);
+  repeated /= (double)bus.strategy.sent / (5 * updates);
+  bus.remove_all_packets();
+  for(uint16_t i = 0; i < slots; i++)
+    bus.send_repeatedly(i % 200 + 2, payload, sizeof(payload), 3600000000);
+  double idle = measure(bus);
+  printf(
+    "%13u %11.1f %15.1f %10.1f\n",
+    PacketMaxLength,
+    busy,
+    repeated,
+    idle
+  );
+};
+
+int main() {
+  printf("%u packets buffered\n", slots);
+  printf("Packet length  Busy ns/pk  Repeated ns/pk  Idle ns/up\n");
+  benchmark<50>();
+  benchmark<255>();
+  benchmark<1024>();
+  benchmark<4096>();
+  return 0;
+};
@@ -0,0 +1,117 @@
+/* Cost of forwarding a packet between two buses of a switch, through the
+   virtual calls of Any (PJONSwitch) and through StrategyVariant
+   (PJONVariantSwitch). Buses use Memory, a strategy that receives one byte
+   per call from memory as serial strategies do, so that the time measured
+   is spent in PJON and in the calls to the strategy. On x86 the two are
+   within run-to-run noise, the indirect calls of Any are predicted. */
+
+#define PJON_INCLUDE_ANY
+#define PJON_INCLUDE_TS
+#define PJON_INCLUDE_LUDP
+#define PJON_PACKET_MAX_LENGTH 255
+#include <PJONSwitch.h>
+
+struct Memory {
+  uint8_t frame[PJON_PACKET_MAX_LENGTH];
+  uint16_t length = 0;
+  uint16_t position = 0;
+  uint32_t sent = 0;
+
+  uint32_t back_off(uint8_t attempts) { return 0; };
+  bool begin(uint8_t additional_randomness = 0) { return true; };
+  bool can_start() { return true; };
+  static uint8_t get_max_attempts() { return 1; };
+  void handle_collision() { };
+  uint16_t receive_response() { return PJON_ACK; };
+  void send_response(uint8_t response) { };
+
+  uint16_t receive_string(uint8_t *string, uint16_t max_length) {
+    if(position >= length) return PJON_FAIL;
+    *string = frame[position++];
+    return 1;
+  };
+
+  void send_string(uint8_t *string, uint16_t length) { sent++; };
+};
+
+/* Expose a single forwarding step: receive from the first bus and send
+   through the second: */
+
+template<class Switch>
+struct Forwarder : public Switch {
+  using Switch::Switch;
+
+  void forward() {
+    this->current_bus = 0;
+    this->buses[0]->receive();
+    this->current_bus = 1;
+    this->buses[1]->update();
+    this->current_bus = PJON_NOT_ASSIGNED;
+  };
+};
+
+const uint8_t sizes[] = { 16, 64, 200 };
+const uint32_t iterations = 200000;
+uint8_t bus_a[] = { 0, 0, 0, 1 }, bus_b[] = { 0, 0, 0, 2 };
+
+/* Returns the lowest average time in nanoseconds of 5 runs: */
+
+template<class Switch>
+double measure(Switch &router, Memory &in, Memory &out) {
+  double best = 0;
+  for(uint8_t run = 0; run < 5; run++) {
+    uint32_t sent = out.sent;
+    auto start = std::chrono::high_resolution_clock::now();
+    for(uint32_t i = 0; i < iterations; i++) {
+      in.position = 0;
+      router.forward();
+    }
+    double seconds = std::chrono::duration<double>(
+      std::chrono::high_resolution_clock::now() - start
+    ).count();
+    // A few packets may be sent by the next updates
+    if(out.sent - sent + 4 < iterations) printf("Packets lost\n");
+    if(!run || seconds < best) best = seconds;
+  }
+  return best * 1000000000 / iterations;
+};
+
+int main() {
+  StrategyLink<Memory> link_a, link_b;
+  PJONAny any_a(&link_a, bus_a, 1, 0), any_b(&link_b, bus_b, 1, 0);
+  PJONAny *any_buses[] = { &any_a, &any_b };
+  Forwarder<PJONSwitch> any_switch(2, any_buses);
+
+  typedef PJONVariant<Memory, ThroughSerial, LocalUDP> Bus;
+  Bus variant_a(bus_a, 1, 0), variant_b(bus_b, 1, 0);
+  Bus *variant_buses[] = { &variant_a, &variant_b };
+  Forwarder<PJONVariantSwitch<Memory, ThroughSerial, LocalUDP>>
+    variant_switch(2, variant_buses);
+  variant_a.strategy.select<Memory>();
+  variant_b.strategy.select<Memory>();
+  any_switch.begin();
+  variant_switch.begin();
+
+  PJON<Memory> source(bus_a, 5);
+  source.set_config_bit(false, PJON_ACK_REQ_BIT);
+  printf("Payload  Any ns/packet  Variant ns/packet\n");
+  for(uint8_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    char payload[PJON_PACKET_MAX_LENGTH];
+    for(uint8_t i = 0; i < sizes[s]; i++) payload[i] = PJON_RANDOM(255);
+    uint16_t length = source.compose_packet(
+      10, bus_b, (char *)link_a.strategy.frame, payload, sizes[s]
+    );
+    link_a.strategy.length = length;
+    Memory &variant_in = variant_a.strategy.get<Memory>();
+    memcpy(variant_in.frame, link_a.strategy.frame, length);
+    variant_in.length = length;
+    double any = measure(any_switch, link_a.strategy, link_b.strategy);
+    double variant = measure(
+      variant_switch,
+      variant_in,
+      variant_b.strategy.get<Memory>()
+    );
+    printf("%7u %14.0f %18.0f\n", sizes[s], any, variant);
+  }
+  return 0;
+};
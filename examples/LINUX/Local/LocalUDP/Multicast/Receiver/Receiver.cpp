@@ -0,0 +1,44 @@
+#define PJON_INCLUDE_LUDP
+#include <PJON.h>
+
+/* Run Receiver with a bus number as argument (1 or 2) and Transmitter
+   in other terminals of the same host. Each Receiver joins only the group
+   of its bus, so it receives only the packets sent to its bus. */
+
+uint8_t bus_one[] = {0, 0, 0, 1};
+uint8_t bus_two[] = {0, 0, 0, 2};
+uint8_t group[] = {239, 0, 0, 100};     // Default group
+uint8_t group_one[] = {239, 0, 0, 1};   // Group of bus 0.0.0.1
+uint8_t group_two[] = {239, 0, 0, 2};   // Group of bus 0.0.0.2
+uint8_t loopback[] = {127, 0, 0, 1};    // Interface used for the test
+
+uint32_t cnt = 0;
+uint32_t start = millis();
+
+void receiver_function(uint8_t *payload, uint16_t length, const PJON_Packet_Info &packet_info) {
+  if(payload[0] == 'P') cnt++;
+}
+
+int main(int argc, char **argv) {
+  bool one = (argc < 2) || (argv[1][0] != '2');
+  // <Strategy name> bus(selected bus id, selected device id)
+  PJON<LocalUDP> bus(one ? bus_one : bus_two, 44);
+  // TTL 1, deliver to the other processes of this host using loopback
+  bus.strategy.set_multicast(group, 1, true, loopback);
+  bus.strategy.add_bus_group(bus_one, group_one, one);
+  bus.strategy.add_bus_group(bus_two, group_two, !one);
+  /* Processes sharing a host and a port can not receive responses
+     reliably, so synchronous acknowledgement is disabled */
+  bus.set_synchronous_acknowledge(false);
+  bus.set_receiver(receiver_function);
+  bus.begin();
+
+  while(true) {
+    bus.receive(1000);
+    if(millis() - start > 1000) {
+      start = millis();
+      printf("Bus %d PING/s: %d\n", one ? 1 : 2, cnt);
+      cnt = 0;
+    }
+  }
+}
@@ -0,0 +1,31 @@
+#define PJON_INCLUDE_LUDP
+#include <PJON.h>
+
+uint8_t bus_one[] = {0, 0, 0, 1};
+uint8_t bus_two[] = {0, 0, 0, 2};
+uint8_t group[] = {239, 0, 0, 100};     // Default group
+uint8_t group_one[] = {239, 0, 0, 1};   // Group of bus 0.0.0.1
+uint8_t group_two[] = {239, 0, 0, 2};   // Group of bus 0.0.0.2
+uint8_t loopback[] = {127, 0, 0, 1};    // Interface used for the test
+
+// <Strategy name> bus(selected bus id, selected device id)
+PJON<LocalUDP> bus(bus_one, 45);
+
+int main() {
+  // TTL 1, deliver to the other processes of this host using loopback
+  bus.strategy.set_multicast(group, 1, true, loopback);
+  // Send to the groups of both buses, join only the group of bus 0.0.0.1
+  bus.strategy.add_bus_group(bus_one, group_one);
+  bus.strategy.add_bus_group(bus_two, group_two, false);
+  bus.set_synchronous_acknowledge(false);
+  bus.begin();
+  // Send P to device 44 of bus 0.0.0.1 100 times per second
+  bus.send_repeatedly(44, bus_one, "P", 1, 10000);
+  // Send P to device 44 of bus 0.0.0.2 10 times per second
+  bus.send_repeatedly(44, bus_two, "P", 1, 100000);
+
+  while(true) {
+    bus.update();
+    bus.receive(1000);
+  }
+}
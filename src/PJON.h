@@ -95,16 +95,42 @@ limitations under the License. */
 #include <PJONDefines.h>
 #include <strategies/PJON_Strategies.h>
 
-template<typename Strategy>
+/* The length of the buffers and the number of packets that can be buffered
+   default to PJON_PACKET_MAX_LENGTH and PJON_MAX_PACKETS, each instance can
+   be sized differently passing them as template parameters:
+   PJON<ThroughSerial, 2, 64> bus;
+   If BufferLength (PJON_PACKETS_BUFFER_LENGTH) is not 0 packets' content is
+   stored in a shared buffer of as many bytes, each packet takes as many
+   bytes as it is long:
+   PJON<LocalUDP, 100, 1024, 4096> bus; */
+
+template<
+  typename Strategy,
+  uint16_t MaxPackets = PJON_MAX_PACKETS,
+  uint16_t PacketMaxLength = PJON_PACKET_MAX_LENGTH,
+  uint32_t BufferLength = PJON_PACKETS_BUFFER_LENGTH
+>
 class PJON {
+    /* Packet buffer index sized for MaxPackets, it hides PJON_Packet_Index
+       so that PJON_PACKET_INDEX_NONE and FREE are sized accordingly: */
+    typedef typename
+      PJON_Index_Type<(MaxPackets < 254)>::Type PJON_Packet_Index;
+
+    static_assert(
+      PacketMaxLength <= PJON_Frame_Limit<Strategy>::value,
+      "PacketMaxLength exceeds the strategy's max_frame_length"
+    );
+
   public:
     Strategy strategy;
     uint8_t config = PJON_TX_INFO_BIT | PJON_ACK_REQ_BIT;
     uint8_t bus_id[4] = {0, 0, 0, 0};
     const uint8_t localhost[4] = {0, 0, 0, 0};
-    uint8_t data[PJON_PACKET_MAX_LENGTH];
+    uint8_t data[PacketMaxLength];
     PJON_Packet_Info last_packet_info;
-    PJON_Packet packets[PJON_MAX_PACKETS];
+    typename
+      PJON_Packet_Type<PacketMaxLength, (BufferLength > 0)>::Type
+        packets[MaxPackets];
     uint16_t port = PJON_BROADCAST;
     uint8_t random_seed = A0;
 
@@ -147,6 +173,8 @@ class PJON {
     void begin() {
       PJON_RANDOM_SEED(PJON_ANALOG_READ(random_seed) + _device_id);
       strategy.begin(_device_id);
+      update_receiver_id(PJON_Bool<PJON_Filtering<Strategy>::value>());
+      check_frame_limit(PJON_Bool<PJON_Frame_Limited<Strategy>::value>());
       #if(PJON_INCLUDE_ASYNC_ACK || PJON_INCLUDE_PACKET_ID)
         _packet_id_seed = PJON_RANDOM(65535) + _device_id;
       #endif
@@ -164,20 +192,49 @@ class PJON {
       uint16_t p_id = 0,
       uint16_t requested_port = PJON_BROADCAST
     ) {
-      uint8_t index = 0;
-      if(header == PJON_NO_HEADER) header = config;
-      if(length > 255) header |= PJON_EXT_LEN_BIT;
-      if((config & PJON_PORT_BIT) || (requested_port != PJON_BROADCAST))
-        header |= PJON_PORT_BIT;
+      uint16_t new_length = compose_packet_head(
+        id, b_id, (uint8_t *)destination, length, header, p_id, requested_port
+      );
+      if(!new_length) return 0;
+      header = destination[1];
 
-      if(
-        (header & PJON_PORT_BIT) &&
-        (requested_port == PJON_BROADCAST) &&
-        (port == PJON_BROADCAST)
-      ) header &= ~PJON_PORT_BIT;
+      memcpy(
+        destination + (new_length - length - (header & PJON_CRC_BIT ? 4 : 1)),
+        source,
+        length
+      );
 
-      if(id == PJON_BROADCAST)
-        header &= ~(PJON_ACK_REQ_BIT | PJON_ACK_MODE_BIT);
+      if(header & PJON_CRC_BIT) {
+        uint32_t computed_crc =
+          PJON_crc32::compute((uint8_t *)destination, new_length - 4);
+        destination[new_length - 4] =
+          (uint8_t)((uint32_t)(computed_crc) >> 24);
+        destination[new_length - 3] =
+          (uint8_t)((uint32_t)(computed_crc) >> 16);
+        destination[new_length - 2] =
+          (uint8_t)((uint32_t)(computed_crc) >>  8);
+        destination[new_length - 1] =
+          (uint8_t)((uint32_t)computed_crc);
+      } else destination[new_length - 1] =
+        PJON_crc8::compute((uint8_t *)destination, new_length - 1);
+      return new_length;
+    };
+
+    /* Compose the fields preceding the payload, returns the length of the
+       packet or 0 if it is too long. The payload follows at
+       new_length - length - PJONTools::crc_overhead(destination[1]): */
+
+    uint16_t compose_packet_head(
+      const uint8_t id,
+      const uint8_t *b_id,
+      uint8_t *destination,
+      uint16_t length,
+      uint8_t  header = PJON_NO_HEADER,
+      uint16_t p_id = 0,
+      uint16_t requested_port = PJON_BROADCAST
+    ) {
+      uint8_t index = 0;
+      header = compose_header(id, length, header, requested_port);
       uint16_t new_length = length + packet_overhead(header);
       bool extended_length = header & PJON_EXT_LEN_BIT;
 
@@ -190,17 +247,7 @@ class PJON {
         (void)p_id; // Avoid unused variable compiler warning
       #endif
 
-      if(new_length > 15 && !(header & PJON_CRC_BIT)) {
-        header |= PJON_CRC_BIT;
-        new_length = (uint16_t)(length + packet_overhead(header));
-      }
-
-      if(new_length > 255 && !extended_length) {
-        header |= PJON_EXT_LEN_BIT;
-        new_length = (uint16_t)(length + packet_overhead(header));
-      }
-
-      if(new_length >= PJON_PACKET_MAX_LENGTH) {
+      if(new_length >= PacketMaxLength) {
         _error(PJON_CONTENT_TOO_LONG, new_length, _custom_pointer);
         return 0;
       }
@@ -210,16 +257,16 @@ class PJON {
       if(extended_length) {
         destination[index++] = (uint8_t)(new_length >> 8);
         destination[index++] = (uint8_t)new_length;
-        destination[index++] = PJON_crc8::compute((uint8_t *)destination, 4);
+        destination[index++] = PJON_crc8::compute(destination, 4);
       } else {
         destination[index++] = (uint8_t)new_length;
-        destination[index++] = PJON_crc8::compute((uint8_t *)destination, 3);
+        destination[index++] = PJON_crc8::compute(destination, 3);
       }
       if(header & PJON_MODE_BIT) {
-        PJONTools::copy_bus_id((uint8_t*) &destination[index], b_id);
+        PJONTools::copy_bus_id(&destination[index], b_id);
         index += 4;
         if(header & PJON_TX_INFO_BIT) {
-          PJONTools::copy_bus_id((uint8_t*) &destination[index], bus_id);
+          PJONTools::copy_bus_id(&destination[index], bus_id);
           index += 4;
         }
       }
@@ -242,13 +289,89 @@ class PJON {
         }
       }
 
+      // Zero the space reserved by the overhead for absent fields, if any
+      uint8_t head_length =
+        new_length - length - PJONTools::crc_overhead(header);
+      if(index < head_length)
+        memset(destination + index, 0, head_length - index);
+      return new_length;
+    };
+
+    /* Compose packet with a header known at compile time, offsets and
+       overhead are constant and unused fields are not compiled:
+       bus.compose_packet<PJON_TX_INFO_BIT | PJON_CRC_BIT>(...);
+       The generic compose_packet is used if the header has to be changed
+       (for example to broadcast or to add the extended length bit). */
+
+    template<uint8_t Header>
+    uint16_t compose_packet(
+      const uint8_t id,
+      const uint8_t *b_id,
+      char *destination,
+      const char *source,
+      uint16_t length,
+      uint16_t p_id = 0,
+      uint16_t requested_port = PJON_BROADCAST
+    ) {
+      static_assert(Header != PJON_NO_HEADER, "PJON_NO_HEADER is not valid");
+      if(compose_header(id, length, Header, requested_port) != Header)
+        return compose_packet(
+          id, b_id, destination, source, length, Header, p_id, requested_port
+        );
+      const uint8_t overhead = PJONTools::packet_overhead(Header);
+      const uint8_t bus_offset = PJONTools::bus_id_offset(Header);
+      const uint8_t id_offset = PJONTools::packet_id_offset(Header);
+      const uint8_t port_offset = PJONTools::port_offset(Header);
+      const uint16_t new_length = length + overhead;
+
+      if(new_length >= PacketMaxLength) {
+        _error(PJON_CONTENT_TOO_LONG, new_length, _custom_pointer);
+        return 0;
+      }
+
+      destination[0] = id;
+      destination[1] = Header;
+      if(Header & PJON_EXT_LEN_BIT) {
+        destination[2] = (uint8_t)(new_length >> 8);
+        destination[3] = (uint8_t)new_length;
+      } else destination[2] = (uint8_t)new_length;
+      destination[bus_offset - 1] =
+        PJON_crc8::compute((uint8_t *)destination, bus_offset - 1);
+      if(Header & PJON_MODE_BIT) {
+        PJONTools::copy_bus_id((uint8_t *)&destination[bus_offset], b_id);
+        if(Header & PJON_TX_INFO_BIT)
+          PJONTools::copy_bus_id(
+            (uint8_t *)&destination[bus_offset + 4],
+            bus_id
+          );
+      }
+      if(Header & PJON_TX_INFO_BIT)
+        destination[PJONTools::sender_id_offset(Header)] = _device_id;
+      if(PJONTools::packet_id_presence(Header)) {
+        if(!p_id) p_id = new_packet_id();
+        destination[id_offset] = (uint8_t)(p_id >> 8);
+        destination[id_offset + 1] = (uint8_t)p_id;
+      }
+      if(Header & PJON_PORT_BIT) {
+        uint16_t p = (requested_port != PJON_BROADCAST) ? requested_port : port;
+        destination[port_offset] = (uint8_t)(p >> 8);
+        destination[port_offset + 1] = (uint8_t)p;
+      }
+      const uint8_t head_end = port_offset + ((Header & PJON_PORT_BIT) ? 2 : 0);
+      if(head_end < overhead - PJONTools::crc_overhead(Header))
+        memset(
+          destination + head_end,
+          0,
+          overhead - PJONTools::crc_overhead(Header) - head_end
+        );
+
       memcpy(
-        destination + (new_length - length - (header & PJON_CRC_BIT ? 4 : 1)),
+        destination + (overhead - PJONTools::crc_overhead(Header)),
         source,
         length
       );
 
-      if(header & PJON_CRC_BIT) {
+      if(Header & PJON_CRC_BIT) {
         uint32_t computed_crc =
           PJON_crc32::compute((uint8_t *)destination, new_length - 4);
         destination[new_length - 4] =
@@ -264,6 +387,36 @@ class PJON {
       return new_length;
     };
 
+    /* Get the header compose_packet uses for a packet, the requested header
+       is adapted to the recipient, to the length and to the port: */
+
+    uint8_t compose_header(
+      uint8_t id,
+      uint16_t length,
+      uint8_t header = PJON_NO_HEADER,
+      uint16_t requested_port = PJON_BROADCAST
+    ) const {
+      if(header == PJON_NO_HEADER) header = config;
+      if(length > 255) header |= PJON_EXT_LEN_BIT;
+      if((config & PJON_PORT_BIT) || (requested_port != PJON_BROADCAST))
+        header |= PJON_PORT_BIT;
+
+      if(
+        (header & PJON_PORT_BIT) &&
+        (requested_port == PJON_BROADCAST) &&
+        (port == PJON_BROADCAST)
+      ) header &= ~PJON_PORT_BIT;
+
+      if(id == PJON_BROADCAST)
+        header &= ~(PJON_ACK_REQ_BIT | PJON_ACK_MODE_BIT);
+
+      if((uint32_t)(length + PJONTools::packet_overhead(header)) > 15)
+        header |= PJON_CRC_BIT;
+      if((uint32_t)(length + PJONTools::packet_overhead(header)) > 255)
+        header |= PJON_EXT_LEN_BIT;
+      return header;
+    };
+
     /* Get device id: */
 
     uint8_t device_id() const {
@@ -283,38 +436,95 @@ class PJON {
       uint16_t requested_port = PJON_BROADCAST,
       uint16_t p_index = PJON_FAIL
     ) {
-      bool req_index = (p_index != PJON_FAIL);
-      for(uint16_t i = ((req_index) ? p_index : 0); i < PJON_MAX_PACKETS; i++)
-        if(packets[i].state == 0 || req_index) {
-          if(!(length = compose_packet(
-            id,
-            b_id,
-            packets[i].content,
-            packet,
-            length,
-            header,
-            p_id,
-            requested_port
-          ))) return PJON_FAIL;
-          packets[i].length = length;
-          packets[i].state = PJON_TO_BE_SENT;
-          packets[i].registration = PJON_MICROS();
-          packets[i].timing = timing;
-          return i;
-        }
-
-      _error(PJON_PACKETS_BUFFER_FULL, PJON_MAX_PACKETS, _custom_pointer);
-      return PJON_FAIL;
+      uint16_t i = (p_index != PJON_FAIL) ? p_index : _free_packet;
+      if(i >= MaxPackets) {
+        _error(PJON_PACKETS_BUFFER_FULL, MaxPackets, _custom_pointer);
+        return PJON_FAIL;
+      }
+      // Too long packets are refused by compose_packet
+      uint16_t packet_length = length +
+        packet_overhead(compose_header(id, length, header, requested_port));
+      char *content = _buffer.allocate(
+        packets,
+        _previous_packet,
+        i,
+        (packet_length < PacketMaxLength) ? packet_length : 0,
+        PJON_PACKET_INDEX_FREE
+      );
+      if(!content) {
+        _error(PJON_PACKETS_BUFFER_FULL, MaxPackets, _custom_pointer);
+        return PJON_FAIL;
+      }
+      #if(PJON_INDEX_PACKETS) // Reindexed, its content is overwritten
+        bool indexed = (_previous_packet[i] != PJON_PACKET_INDEX_FREE);
+        if(indexed) unindex_packet(i);
+      #endif
+      length = compose_packet(
+        id,
+        b_id,
+        content,
+        packet,
+        length,
+        header,
+        p_id,
+        requested_port
+      );
+      _buffer.commit(packets, i, content, length);
+      if(!length) {
+        #if(PJON_INDEX_PACKETS) // Not overwritten, indexed as it was
+          if(indexed) link_index(i);
+        #endif
+        return PJON_FAIL;
+      }
+      _packet_receiver[i] = content[0];
+      _packet_header[i] = content[1];
+      #if(PJON_INDEX_PACKETS)
+        index_packet(i);
+      #endif
+      if(_previous_packet[i] == PJON_PACKET_INDEX_FREE) {
+        link_packet(i);
+        #if(PJON_PRIORITIES > 1)
+          _packet_priority[i] = PJON_PRIORITIES - 1;
+        #endif
+        #if(PJON_INCLUDE_COMPLETION)
+          _packet_completion[i] = NULL;
+          _packet_dispatched[i] = PJON_MICROS();
+          _packet_timeout[i] = 0;
+        #endif
+      }
+      packets[i].length = length;
+      _packet_state[i] = PJON_TO_BE_SENT;
+      _packet_registration[i] = PJON_MICROS();
+      _packet_timing[i] = timing;
+      _packet_sequence[i] = _dispatch_sequence++;
+      schedule_packet(i, _packet_registration[i]);
+      return i;
     };
 
     /* Check if a packet id is already dispatched in buffer: */
 
     bool dispatched(PJON_Packet_Info info) {
       PJON_Packet_Info actual_info;
-      for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++) {
+      #if(PJON_INDEX_PACKETS) // Visit packets with the same id and receiver
+        for(
+          PJON_Packet_Index i = _index.first(info.id, info.sender_id);
+          i != PJON_PACKET_INDEX_NONE;
+          i = _index.after(i)
+        ) {
+          if(
+            _index.id(i) != info.id ||
+            _packet_receiver[i] != info.sender_id
+          ) continue;
+      #else
+        for(
+          PJON_Packet_Index i = _first_packet;
+          i != PJON_PACKET_INDEX_NONE;
+          i = _next_packet[i]
+        ) {
+      #endif
         parse((uint8_t *)packets[i].content, actual_info);
         if(
-          packets[i].state && packets[i].state != PJON_ACK &&
+          _packet_state[i] && _packet_state[i] != PJON_ACK &&
           (actual_info.header & PJON_ACK_MODE_BIT) &&
           (actual_info.header & PJON_TX_INFO_BIT)
         )
@@ -339,16 +549,33 @@ class PJON {
 
     uint16_t get_packets_count(uint8_t device_id = PJON_NOT_ASSIGNED) const {
       uint16_t packets_count = 0;
-      for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++) {
-        if(packets[i].state == 0) continue;
+      for(
+        PJON_Packet_Index i = _first_packet;
+        i != PJON_PACKET_INDEX_NONE;
+        i = _next_packet[i]
+      ) {
+        if(_packet_state[i] == 0) continue;
         if(
           device_id == PJON_NOT_ASSIGNED ||
-          packets[i].content[0] == device_id
+          _packet_receiver[i] == device_id
         ) packets_count++;
       }
       return packets_count;
     };
 
+    /* Get the priority of the packet in the buffer at index: */
+
+    uint8_t get_packet_priority(uint16_t index) const {
+      return (index < MaxPackets) ? packet_priority(index) : 0;
+    };
+
+    /* Get the state of the packet in the buffer at index (the value
+       returned by send), 0 if the slot is free: */
+
+    uint16_t get_packet_state(uint16_t index) const {
+      return (index < MaxPackets) ? _packet_state[index] : 0;
+    };
+
     /* Generate a new packet id: */
 
     uint16_t new_packet_id() {
@@ -360,23 +587,8 @@ class PJON {
     /* Calculate packet overhead: */
 
     uint8_t packet_overhead(uint8_t  header = PJON_NO_HEADER) const {
-      header = (header == PJON_NO_HEADER) ? config : header;
-      return (
-        (
-          (header & PJON_MODE_BIT) ?
-            (header & PJON_TX_INFO_BIT   ? 10 : 5) :
-            (header & PJON_TX_INFO_BIT   ?  2 : 1)
-        ) + (header & PJON_EXT_LEN_BIT   ?  2 : 1)
-          + (header & PJON_CRC_BIT       ?  4 : 1)
-          + (header & PJON_PORT_BIT      ?  2 : 0)
-          + (
-              (
-                (header & PJON_ACK_MODE_BIT) ||
-                (header & PJON_PACKET_ID_BIT)
-              ) ? 2 : 0
-            )
-          + 1 // Header
-          + 1 // Header CRC
+      return PJONTools::packet_overhead(
+        (header == PJON_NO_HEADER) ? config : header
       );
     };
 
@@ -387,16 +599,62 @@ class PJON {
       packet_info.custom_pointer = _custom_pointer;
     };
 
+    /* Parse a packet expected to have a header known at compile time, the
+       generic parse is used if its header is different: */
+
+    template<uint8_t Header>
+    void parse(const uint8_t *packet, PJON_Packet_Info &packet_info) const {
+      if(packet[1] != Header) return parse(packet, packet_info);
+      const uint8_t bus_offset = PJONTools::bus_id_offset(Header);
+      const uint8_t id_offset = PJONTools::packet_id_offset(Header);
+      const uint8_t port_offset = PJONTools::port_offset(Header);
+      packet_info.header = Header;
+      packet_info.receiver_id = packet[0];
+      if(Header & PJON_MODE_BIT)
+        PJONTools::copy_bus_id(
+          packet_info.receiver_bus_id,
+          packet + bus_offset
+        );
+      else memset(packet_info.receiver_bus_id, 0, 4);
+      if((Header & PJON_MODE_BIT) && (Header & PJON_TX_INFO_BIT))
+        PJONTools::copy_bus_id(
+          packet_info.sender_bus_id,
+          packet + bus_offset + 4
+        );
+      else memset(packet_info.sender_bus_id, 0, 4);
+      packet_info.sender_id = (Header & PJON_TX_INFO_BIT) ?
+        packet[PJONTools::sender_id_offset(Header)] : 0;
+      packet_info.id = PJONTools::packet_id_presence(Header) ?
+        (packet[id_offset] << 8) | (packet[id_offset + 1] & 0xFF) : 0;
+      packet_info.port = (Header & PJON_PORT_BIT) ?
+        (packet[port_offset] << 8) | (packet[port_offset + 1] & 0xFF) : 0;
+      packet_info.custom_pointer = _custom_pointer;
+    };
+
     /* Try to receive data: */
 
     uint16_t receive() {
-      uint16_t length = PJON_PACKET_MAX_LENGTH;
+      uint16_t length = PacketMaxLength;
       uint16_t batch_length = 0;
       uint8_t  overhead = 0;
       bool extended_length = false;
       bool async_ack = false;
+      /* CRCs are computed while bytes are received, the header CRC is
+         verified as soon as it is received and the packet's CRC as soon as
+         the last byte is received */
+      uint8_t  header_crc = 0;
+      uint32_t crc = 0;
+      uint16_t crc_length = 0; // Bytes covered by the packet's CRC
+      uint16_t crc_index = 0;  // Bytes already included in crc
+      // If the strategy supports it the whole frame is received at once
+      uint16_t frame_length =
+        receive_frame(PJON_Bool<PJON_Framed<Strategy>::value>());
+      if(frame_length == PJON_FAIL) return PJON_FAIL;
+      batch_length = frame_length;
       for(uint16_t i = 0; i < length; i++) {
         if(!batch_length) {
+          // The frame is shorter than the length it declares
+          if(frame_length) return PJON_FAIL;
           batch_length = strategy.receive_string(data + i, length - i);
           if(batch_length == PJON_FAIL || batch_length == 0)
             return PJON_FAIL;
@@ -432,13 +690,14 @@ class PJON {
             (data[1] & PJON_ACK_MODE_BIT) &&
             (data[1] & PJON_TX_INFO_BIT)
           );
+          if(data[1] & PJON_CRC_BIT) crc = 0xFFFFFFFF;
         }
 
         if((i == 2) && !extended_length) {
           length = data[i];
           if(
             length < (uint8_t)(overhead + !async_ack) ||
-            length >= PJON_PACKET_MAX_LENGTH
+            length >= PacketMaxLength
           ) return PJON_BUSY;
           if(length > 15 && !(data[1] & PJON_CRC_BIT)) return PJON_BUSY;
         }
@@ -447,32 +706,46 @@ class PJON {
           length = (data[i - 1] << 8) | (data[i] & 0xFF);
           if(
             length < (uint8_t)(overhead + !async_ack) ||
-            length >= PJON_PACKET_MAX_LENGTH
+            length >= PacketMaxLength
           ) return PJON_BUSY;
           if(length > 15 && !(data[1] & PJON_CRC_BIT)) return PJON_BUSY;
         }
 
+        if(i < (uint8_t)(3 + extended_length))
+          header_crc = PJON_crc8::roll(data[i], header_crc);
+        else if(i == (uint8_t)(3 + extended_length)) {
+          if(header_crc != data[i]) return PJON_NAK;
+          crc_length = length - ((data[1] & PJON_CRC_BIT) ? 4 : 1);
+        }
+
         if((i >= 1) && (data[1] & PJON_MODE_BIT) && !_router)
           if(
             (i > (uint8_t)(3 + extended_length)) &&
             (i < (uint8_t)(8 + extended_length))
           ) if(bus_id[i - 4 - extended_length] != data[i])
               return PJON_BUSY;
-      }
 
-      if(
-        PJON_crc8::compute(data, 3 + extended_length) !=
-        data[3 + extended_length]
-      ) return PJON_NAK;
+        // Include in the CRC the bytes of each batch as it is completed
+        if(crc_length && (!batch_length || (i + 1) == length)) {
+          uint16_t end = ((uint16_t)(i + 1) < crc_length) ? i + 1 : crc_length;
+          if(end > crc_index) {
+            if(data[1] & PJON_CRC_BIT)
+              crc = PJON_crc32::update(crc, data + crc_index, end - crc_index);
+            else
+              crc = PJON_crc8::compute(
+                data + crc_index,
+                end - crc_index,
+                (uint8_t)crc
+              );
+            crc_index = end;
+          }
+        }
+      }
 
+      if(frame_length && (frame_length != length)) return PJON_FAIL;
       if(data[1] & PJON_CRC_BIT) {
-        if(
-          !PJON_crc32::compare(
-            PJON_crc32::compute(data, length - 4), data + (length - 4)
-          )
-        ) return PJON_NAK;
-      } else if(PJON_crc8::compute(data, length - 1) != data[length - 1])
-        return PJON_NAK;
+        if(!PJON_crc32::compare(~crc, data + (length - 4))) return PJON_NAK;
+      } else if((uint8_t)crc != data[length - 1]) return PJON_NAK;
 
       if(data[1] & PJON_ACK_REQ_BIT && data[0] != PJON_BROADCAST)
         if((_mode != PJON_SIMPLEX) && !_router)
@@ -538,11 +811,23 @@ class PJON {
     /* Remove a packet from buffer: */
 
     void remove(uint16_t index) {
-      if((index >= 0) && (index < PJON_MAX_PACKETS)) {
-        packets[index].attempts = 0;
+      if((index >= 0) && (index < MaxPackets)) {
+        if(_previous_packet[index] != PJON_PACKET_INDEX_FREE) {
+          unlink_packet(index);
+          unschedule_packet(index);
+          #if(PJON_INDEX_PACKETS)
+            unindex_packet(index);
+          #endif
+          if(_first_packet == PJON_PACKET_INDEX_NONE) _buffer.clear();
+          else _buffer.release(packets[index].content);
+        }
+        _packet_attempts[index] = 0;
         packets[index].length = 0;
-        packets[index].registration = 0;
-        packets[index].state = 0;
+        _packet_registration[index] = 0;
+        _packet_state[index] = 0;
+        #if(PJON_INCLUDE_COMPLETION)
+          _packet_completion[index] = NULL;
+        #endif
       }
     };
 
@@ -550,7 +835,24 @@ class PJON {
 
     bool handle_asynchronous_acknowledgment(PJON_Packet_Info packet_info) {
       PJON_Packet_Info actual_info;
-      for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++) {
+      #if(PJON_INDEX_PACKETS) // Visit packets with the same id and receiver
+        for(
+          PJON_Packet_Index i =
+            _index.first(packet_info.id, packet_info.sender_id);
+          i != PJON_PACKET_INDEX_NONE;
+          i = _index.after(i)
+        ) {
+          if(
+            _index.id(i) != packet_info.id ||
+            _packet_receiver[i] != packet_info.sender_id
+          ) continue;
+      #else
+        for(
+          PJON_Packet_Index i = _first_packet;
+          i != PJON_PACKET_INDEX_NONE;
+          i = _next_packet[i]
+        ) {
+      #endif
         parse((uint8_t *)packets[i].content, actual_info);
         if(actual_info.id == packet_info.id)
           if(actual_info.receiver_id == packet_info.sender_id && (
@@ -561,25 +863,25 @@ class PJON {
                 packet_info.sender_bus_id
               )
           )) {
-            if(packets[i].timing) {
+            if(_packet_timing[i]) {
               uint8_t offset = packet_overhead(actual_info.header);
               uint8_t crc_offset =
                 ((actual_info.header & PJON_CRC_BIT) ? 4 : 1);
+              _packet_attempts[i] = 0;
               dispatch(
                 actual_info.receiver_id,
                 (uint8_t *)actual_info.receiver_bus_id,
                 packets[i].content + (offset - crc_offset),
                 packets[i].length - offset,
-                packets[i].timing,
+                _packet_timing[i],
                 actual_info.header,
                 new_packet_id(),
                 actual_info.port,
                 i
               );
-              packets[i].attempts = 0;
               return true;
             }
-            remove(i);
+            complete(i, PJON_ACK);
             return true;
           }
       }
@@ -591,9 +893,14 @@ class PJON {
        Pass a device id to delete all it's related packets  */
 
     void remove_all_packets(uint8_t device_id = 0) {
-      for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++) {
-        if(packets[i].state == 0) continue;
-        if(!device_id || packets[i].content[0] == device_id) remove(i);
+      PJON_Packet_Index next;
+      for(
+        PJON_Packet_Index i = _first_packet;
+        i != PJON_PACKET_INDEX_NONE;
+        i = next
+      ) {
+        next = _next_packet[i];
+        if(!device_id || _packet_receiver[i] == device_id) remove(i);
       }
     };
 
@@ -667,20 +974,20 @@ class PJON {
       uint8_t original_device_id = _device_id;
       uint8_t original_bus_id[4];
       PJONTools::copy_bus_id(original_bus_id, bus_id);
-      set_id(sender_id);
+      // Not set_id, the strategy keeps receiving for the actual device id
+      _device_id = sender_id;
       PJONTools::copy_bus_id(bus_id, sender_bus_id);
       uint16_t result = PJON_FAIL;
-      #if(PJON_MAX_PACKETS > 0)
+      if(MaxPackets > 0)
         result = dispatch(
           id, b_id, string, length, 0, header, p_id, requested_port
         );
-      #endif
       if(result == PJON_FAIL)
         result = send_packet_blocking(
           id, b_id, string, length, header, p_id, requested_port
         );
       PJONTools::copy_bus_id(bus_id, original_bus_id);
-      set_id(original_device_id);
+      _device_id = original_device_id;
       return result;
     };
 
@@ -722,20 +1029,24 @@ class PJON {
     /* Transmit an already composed packet:  */
 
     uint16_t send_packet(const char *string, uint16_t length) {
-      if(!string) return PJON_FAIL;
+      uint16_t result = transmit_packet(string, length);
+      flush(PJON_Bool<PJON_Flushing<Strategy>::value>());
+      return result;
+    };
+
+    /* Transmit an already composed packet passed in parts. If the strategy
+       does not support it the parts are copied in the data buffer: */
+
+    uint16_t send_packet(const PJON_Packet_Part *parts, uint8_t count) {
+      uint32_t length = 0;
+      for(uint8_t i = 0; i < count; i++) length += parts[i].length;
+      if(!count || parts[0].length < 2 || length > PacketMaxLength)
+        return PJON_FAIL;
       if(_mode != PJON_SIMPLEX && !strategy.can_start()) return PJON_BUSY;
-      strategy.send_string((uint8_t *)string, length);
-      if(
-        string[0] == PJON_BROADCAST ||
-        !(string[1] & PJON_ACK_REQ_BIT) ||
-        _mode == PJON_SIMPLEX
-      ) return PJON_ACK;
-      uint16_t response = strategy.receive_response();
-      if(
-        response == PJON_ACK ||
-        response == PJON_FAIL
-      ) return response;
-      else return PJON_BUSY;
+      send_parts(parts, count, PJON_Bool<PJON_Gather<Strategy>::value>());
+      uint16_t result = transmission_result(parts[0].data);
+      flush(PJON_Bool<PJON_Flushing<Strategy>::value>());
+      return result;
     };
 
     /* Compose and transmit a packet passing its info as parameters: */
@@ -748,10 +1059,11 @@ class PJON {
       uint16_t p_id = 0,
       uint16_t requested_port = PJON_BROADCAST
     ) {
-      if(!(length = compose_packet(
-        id, bus_id, (char *)data, string, length, header, p_id, requested_port
-      ))) return PJON_FAIL;
-      return send_packet((char *)data, length);
+      uint16_t result = send_payload(
+        id, bus_id, string, length, header, p_id, requested_port,
+        PJON_Bool<PJON_Gather<Strategy>::value>()
+      );
+      return result ? result : PJON_FAIL;
     };
 
     uint16_t send_packet(
@@ -763,8 +1075,26 @@ class PJON {
       uint16_t p_id = 0,
       uint16_t requested_port = PJON_BROADCAST
     ) {
-      if(!(length = compose_packet(
-        id, b_id, (char *)data, string, length, header, p_id, requested_port
+      uint16_t result = send_payload(
+        id, b_id, string, length, header, p_id, requested_port,
+        PJON_Bool<PJON_Gather<Strategy>::value>()
+      );
+      return result ? result : PJON_FAIL;
+    };
+
+    /* Compose and transmit a packet with a header known at compile time: */
+
+    template<uint8_t Header>
+    uint16_t send_packet(
+      uint8_t id,
+      const uint8_t *b_id,
+      const char *string,
+      uint16_t length,
+      uint16_t p_id = 0,
+      uint16_t requested_port = PJON_BROADCAST
+    ) {
+      if(!(length = compose_packet<Header>(
+        id, b_id, (char *)data, string, length, p_id, requested_port
       ))) return PJON_FAIL;
       return send_packet((char *)data, length);
     };
@@ -786,27 +1116,19 @@ class PJON {
       uint16_t state = PJON_FAIL;
       uint32_t attempts = 0;
       uint32_t start = PJON_MICROS();
-      uint16_t old_length = length;
 
       _recursion++;
       while(
         (state != PJON_ACK) && (attempts <= strategy.get_max_attempts()) &&
         (uint32_t)(PJON_MICROS() - start) <= timeout
       ) {
-        if(!(length = compose_packet(
-          id,
-          b_id,
-          (char *)data,
-          string,
-          old_length,
-          header,
-          p_id,
-          requested_port
+        if(!(state = send_payload(
+          id, b_id, string, length, header, p_id, requested_port,
+          PJON_Bool<PJON_Gather<Strategy>::value>()
         ))) {
           _recursion--;
           return PJON_FAIL;
         }
-        state = send_packet((char*)data, length);
         if(state == PJON_ACK) {
           _recursion--;
           return state;
@@ -890,6 +1212,78 @@ class PJON {
       set_config_bit(state, PJON_PACKET_ID_BIT);
     };
 
+    /* Set the priority of the packet in the buffer at index (the value
+       returned by send), from 0 (the highest) to PJON_PRIORITIES - 1 (the
+       lowest, given to the packets when dispatched): */
+
+    void set_packet_priority(uint16_t index, uint8_t priority) {
+      #if(PJON_PRIORITIES > 1)
+        if(
+          (index >= MaxPackets) || (priority >= PJON_PRIORITIES) ||
+          (_previous_packet[index] == PJON_PACKET_INDEX_FREE)
+        ) return;
+        unschedule_packet(index);
+        _packet_priority[index] = priority;
+        insert_packet(index);
+      #endif
+    };
+
+    /* Set the order in which due packets of different priority are sent:
+       PJON_STRICT_PRIORITY: the ones with the highest priority first
+       PJON_WEIGHTED_PRIORITY: each priority in turn, in proportion to its
+       weight (see set_priority_weight) */
+
+    void set_priority_mode(uint8_t mode) {
+      _priority_mode = mode;
+    };
+
+    /* Set the weight of a priority in PJON_WEIGHTED_PRIORITY mode (1 or
+       more, PJON_PRIORITIES - priority by default): */
+
+    void set_priority_weight(uint8_t priority, uint8_t weight) {
+      if(priority < PJON_PRIORITIES)
+        _priority_weight[priority] = weight ? weight : 1;
+    };
+
+    /* Set a function called when the packet in the buffer at index (the
+       handle returned by send) is removed by PJON, with the handle, the
+       result and the microseconds elapsed since it was dispatched. The
+       result is PJON_ACK if it was delivered, PJON_FAIL if its attempts
+       are exhausted or PJON_TIMEOUT if timeout microseconds (if not 0)
+       passed before. It is not called if the packet is removed by the user
+       or, if packet auto deletion is disabled, when it is delivered.
+       PJON_INCLUDE_COMPLETION must be set to true:
+
+      void completion_function(
+        uint16_t handle,
+        uint16_t result,
+        uint32_t latency,
+        void *custom_pointer
+      ) {
+        if(result == PJON_ACK) Serial.println(latency);
+      };
+
+      bus.set_packet_completion(bus.send(10, "Hi", 2), completion_function);
+      */
+
+    #if(PJON_INCLUDE_COMPLETION)
+      void set_packet_completion(
+        uint16_t index,
+        PJON_Completion completion,
+        uint32_t timeout = 0
+      ) {
+        if(
+          (index >= MaxPackets) ||
+          (_previous_packet[index] == PJON_PACKET_INDEX_FREE)
+        ) return;
+        _packet_completion[index] = completion;
+        // Clamped to keep deadlines comparable
+        _packet_timeout[index] = (timeout > 0x7FFFFFFE) ? 0x7FFFFFFE : timeout;
+        schedule_expiry(index);
+        sift_packet(index, _schedule_position[index]);
+      };
+    #endif
+
     /* Set a custom receiver callback pointer:
        (Generally needed to call a custom member function) */
 
@@ -905,10 +1299,34 @@ class PJON {
         set_shared_network(true);
       set_error(PJON_dummy_error_handler);
       set_receiver(PJON_dummy_receiver_handler);
-      for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++) {
-        packets[i].state = 0;
-        packets[i].timing = 0;
-        packets[i].attempts = 0;
+      _first_packet = PJON_PACKET_INDEX_NONE;
+      _last_packet = PJON_PACKET_INDEX_NONE;
+      _free_packet = MaxPackets ? 0 : PJON_PACKET_INDEX_NONE;
+      _scheduled_packets = 0;
+      _priority_mode = PJON_STRICT_PRIORITY;
+      for(uint8_t p = 0; p < PJON_PRIORITIES; p++) {
+        _schedule_length[p] = 0;
+        _priority_credit[p] = 0;
+        _priority_weight[p] = PJON_PRIORITIES - p;
+      }
+      _buffer.clear();
+      #if(PJON_INCLUDE_ASYNC_ACK || PJON_INCLUDE_PACKET_ID)
+        _recent_packet_id_head = 0;
+        _recent_packet_ids = 0;
+        for(uint32_t i = 0; i < PJON_RECENT_PACKET_ID_TABLE; i++)
+          _recent_packet_id_table[i] = PJON_RECENT_PACKET_ID_NONE;
+      #endif
+      #if(PJON_INDEX_PACKETS)
+        _index.clear();
+      #endif
+      for(uint16_t i = 0; i < MaxPackets; i++) {
+        _packet_state[i] = 0;
+        _packet_timing[i] = 0;
+        _packet_attempts[i] = 0;
+        _next_packet[i] = ((i + 1) < MaxPackets) ?
+          i + 1 : PJON_PACKET_INDEX_NONE;
+        _previous_packet[i] = PJON_PACKET_INDEX_FREE;
+        _schedule_position[i] = PJON_PACKET_INDEX_NONE;
       }
     };
 
@@ -931,6 +1349,7 @@ class PJON {
 
     void set_id(uint8_t id) {
       _device_id = id;
+      update_receiver_id(PJON_Bool<PJON_Filtering<Strategy>::value>());
     };
 
     /* Include the port passing a boolean state and an unsigned integer: */
@@ -1000,76 +1419,57 @@ class PJON {
 
     void set_router(bool state) {
       _router = state;
+      update_receiver_id(PJON_Bool<PJON_Filtering<Strategy>::value>());
     };
 
     /* Update the state of the send list:
        Check if there are packets to be sent or to be erased if correctly
-       delivered. Returns the actual number of packets to be sent. */
+       delivered. Returns the actual number of packets to be sent.
+       Only packets due for transmission are visited, see next_deadline().
+       Due packets are visited in priority order, see set_priority_mode(). */
 
     uint16_t update() {
-      uint16_t packets_count = 0;
-      for(uint16_t i = 0; i < PJON_MAX_PACKETS; i++) {
-        if(packets[i].state == 0) continue;
-        packets_count++;
-        bool async_ack = (packets[i].content[1] & PJON_ACK_MODE_BIT) &&
-          (packets[i].content[1] & PJON_TX_INFO_BIT);
-        bool sync_ack = (packets[i].content[1] & PJON_ACK_REQ_BIT);
-
+      uint32_t now = PJON_MICROS();
+      uint8_t p;
+      while((p = due_priority(now)) < PJON_PRIORITIES) {
+        PJON_Packet_Index i = _schedule[p][0];
+        #if(PJON_INCLUDE_COMPLETION)
+          if(packet_expired(i, now)) {
+            complete(i, PJON_TIMEOUT);
+            continue;
+          }
+        #endif
         if(
-          (uint32_t)(PJON_MICROS() - packets[i].registration) >
+          (uint32_t)(now - _packet_registration[i]) >
           (uint32_t)(
-            packets[i].timing +
-            strategy.back_off(packets[i].attempts)
+            _packet_timing[i] +
+            strategy.back_off(_packet_attempts[i])
           )
-        ) {
-          if(!(sync_ack && async_ack && packets[i].state == PJON_ACK))
-            packets[i].state = // Avoid resending sync-acked async ack packets
-              send_packet(packets[i].content, packets[i].length);
-        } else continue;
-
-        packets[i].attempts++;
-
-        if(packets[i].state == PJON_ACK) {
-          if(!packets[i].timing) {
-            if(
-              _auto_delete && (
-                (
-                  packets[i].length == packet_overhead(packets[i].content[1])
-                  && async_ack
-                ) || !(packets[i].content[1] & PJON_ACK_MODE_BIT)
-              )
-            ) {
-              remove(i);
-              packets_count--;
-            }
-          } else {
-            if(!async_ack) {
-              packets[i].attempts = 0;
-              packets[i].registration = PJON_MICROS();
-              packets[i].state = PJON_TO_BE_SENT;
-            }
-          }
-          if(!async_ack) continue;
-        }
+        ) update_packet(i);
+        // Each packet is visited at most once per update call
+        if(_schedule_position[i] != PJON_PACKET_INDEX_NONE)
+          schedule_packet(i, PJON_MICROS(), 1);
+      }
+      flush(PJON_Bool<PJON_Flushing<Strategy>::value>());
+      return _scheduled_packets;
+    };
 
-        if(packets[i].state != PJON_FAIL && packets[i].state != PJON_ACK)
-          strategy.handle_collision();
+    /* Get the time in microseconds until the next packet is due for
+       transmission (0 if already due, 0xFFFFFFFF if the buffer is empty).
+       Can be used to sleep instead of calling update() continuously: */
 
-        if(packets[i].attempts > strategy.get_max_attempts()) {
-          _error(PJON_CONNECTION_LOST, i, _custom_pointer);
-          if(!packets[i].timing) {
-            if(_auto_delete) {
-              remove(i);
-              packets_count--;
-            }
-          } else {
-            packets[i].attempts = 0;
-            packets[i].registration = PJON_MICROS();
-            packets[i].state = PJON_TO_BE_SENT;
-          }
-        }
-      }
-      return packets_count;
+    uint32_t next_deadline() const {
+      if(!_scheduled_packets) return 0xFFFFFFFF;
+      PJON_Packet_Index first = PJON_PACKET_INDEX_NONE;
+      for(uint8_t p = 0; p < PJON_PRIORITIES; p++)
+        if(
+          _schedule_length[p] && (
+            (first == PJON_PACKET_INDEX_NONE) ||
+            packet_earlier(_schedule[p][0], first)
+          )
+        ) first = _schedule[p][0];
+      uint32_t remaining = _packet_deadline[first] - PJON_MICROS();
+      return ((int32_t)remaining > 0) ? remaining : 0;
     };
 
     /* Check if the packet id and its transmitter info are already present in
@@ -1077,45 +1477,528 @@ class PJON {
 
     bool known_packet_id(PJON_Packet_Info info) {
       #if(PJON_INCLUDE_ASYNC_ACK || PJON_INCLUDE_PACKET_ID)
-        for(uint8_t i = 0; i < PJON_MAX_RECENT_PACKET_IDS; i++)
-          if(
-            info.id == recent_packet_ids[i].id &&
-            info.sender_id == recent_packet_ids[i].sender_id && (
-              (
-                (info.header & PJON_MODE_BIT) &&
-                (recent_packet_ids[i].header & PJON_MODE_BIT) &&
-                PJONTools::bus_id_equality(
-                  (uint8_t *)info.sender_bus_id,
-                  (uint8_t *)recent_packet_ids[i].sender_bus_id
-                )
-              ) || (
-                !(info.header & PJON_MODE_BIT) &&
-                !(recent_packet_ids[i].header & PJON_MODE_BIT)
-              )
-            )
-          ) return true;
+        PJON_Packet_Record record;
+        record.id = info.id;
+        record.header = info.header;
+        record.sender_id = info.sender_id;
+        PJONTools::copy_bus_id(record.sender_bus_id, info.sender_bus_id);
+        uint32_t position = record_hash(record);
+        for(
+          PJON_Record_Index r;
+          (r = _recent_packet_id_table[position]) != PJON_RECENT_PACKET_ID_NONE;
+          position = (position + 1) & (PJON_RECENT_PACKET_ID_TABLE - 1)
+        ) if(record_equality(record, recent_packet_ids[r])) return true;
         save_packet_id(info);
       #endif
       return false;
     };
 
-    /* Save packet id in the buffer: */
+    /* Save packet id in the buffer, replacing the oldest if full: */
 
     void save_packet_id(PJON_Packet_Info info) {
       #if(PJON_INCLUDE_ASYNC_ACK || PJON_INCLUDE_PACKET_ID)
-        for(uint8_t i = PJON_MAX_RECENT_PACKET_IDS - 1; i > 0; i--)
-          recent_packet_ids[i] = recent_packet_ids[i - 1];
-        recent_packet_ids[0].id = info.id;
-        recent_packet_ids[0].header = info.header;
-        recent_packet_ids[0].sender_id = info.sender_id;
+        PJON_Record_Index r = _recent_packet_id_head;
+        if(_recent_packet_ids < PJON_MAX_RECENT_PACKET_IDS)
+          _recent_packet_ids++;
+        else forget_packet_id(r);
+        recent_packet_ids[r].id = info.id;
+        recent_packet_ids[r].header = info.header;
+        recent_packet_ids[r].sender_id = info.sender_id;
         PJONTools::copy_bus_id(
-          recent_packet_ids[0].sender_bus_id,
+          recent_packet_ids[r].sender_bus_id,
           info.sender_bus_id
         );
+        uint32_t position = record_hash(recent_packet_ids[r]);
+        while(_recent_packet_id_table[position] != PJON_RECENT_PACKET_ID_NONE)
+          position = (position + 1) & (PJON_RECENT_PACKET_ID_TABLE - 1);
+        _recent_packet_id_table[position] = r;
+        if(++_recent_packet_id_head == PJON_MAX_RECENT_PACKET_IDS)
+          _recent_packet_id_head = 0;
       #endif
     };
 
   private:
+    /* Packet buffer slots lists, slots in use are doubly linked in dispatch
+       order, free slots are singly linked and marked as free: */
+
+    void link_packet(PJON_Packet_Index i) {
+      if(_free_packet == i) _free_packet = _next_packet[i];
+      else
+        for(PJON_Packet_Index f = _free_packet; f != PJON_PACKET_INDEX_NONE;)
+          if(_next_packet[f] == i) {
+            _next_packet[f] = _next_packet[i];
+            break;
+          } else f = _next_packet[f];
+      _next_packet[i] = PJON_PACKET_INDEX_NONE;
+      _previous_packet[i] = _last_packet;
+      if(_last_packet != PJON_PACKET_INDEX_NONE) _next_packet[_last_packet] = i;
+      else _first_packet = i;
+      _last_packet = i;
+    };
+
+    void unlink_packet(PJON_Packet_Index i) {
+      if(_previous_packet[i] != PJON_PACKET_INDEX_NONE)
+        _next_packet[_previous_packet[i]] = _next_packet[i];
+      else _first_packet = _next_packet[i];
+      if(_next_packet[i] != PJON_PACKET_INDEX_NONE)
+        _previous_packet[_next_packet[i]] = _previous_packet[i];
+      else _last_packet = _previous_packet[i];
+      _next_packet[i] = _free_packet;
+      _previous_packet[i] = PJON_PACKET_INDEX_FREE;
+      _free_packet = i;
+    };
+
+    /* Compose and transmit a packet, returns 0 if it can't be composed.
+       If the strategy supports it, the payload is not copied: the fields
+       preceding it are composed in a stack buffer and the CRC is computed
+       across them and the payload: */
+
+    uint16_t send_payload(
+      uint8_t id,
+      const uint8_t *b_id,
+      const char *string,
+      uint16_t length,
+      uint8_t  header,
+      uint16_t p_id,
+      uint16_t requested_port,
+      PJON_Bool<true>
+    ) {
+      uint8_t head[PJON_PACKET_HEAD_MAX_LENGTH];
+      uint8_t crc[4];
+      uint16_t new_length = compose_packet_head(
+        id, b_id, head, length, header, p_id, requested_port
+      );
+      if(!new_length) return 0;
+      uint8_t crc_length = PJONTools::crc_overhead(head[1]);
+      uint8_t head_length = new_length - length - crc_length;
+      if(head[1] & PJON_CRC_BIT) {
+        uint32_t computed_crc = PJON_crc32::compute(
+          (const uint8_t *)string,
+          length,
+          PJON_crc32::compute(head, head_length)
+        );
+        crc[0] = (uint8_t)(computed_crc >> 24);
+        crc[1] = (uint8_t)(computed_crc >> 16);
+        crc[2] = (uint8_t)(computed_crc >>  8);
+        crc[3] = (uint8_t)computed_crc;
+      } else crc[0] = PJON_crc8::compute(
+        (const uint8_t *)string,
+        length,
+        PJON_crc8::compute(head, head_length)
+      );
+      const PJON_Packet_Part parts[3] = {
+        {head, head_length},
+        {(const uint8_t *)string, length},
+        {crc, crc_length}
+      };
+      return send_packet(parts, 3);
+    };
+
+    uint16_t send_payload(
+      uint8_t id,
+      const uint8_t *b_id,
+      const char *string,
+      uint16_t length,
+      uint8_t  header,
+      uint16_t p_id,
+      uint16_t requested_port,
+      PJON_Bool<false>
+    ) {
+      if(!(length = compose_packet(
+        id, b_id, (char *)data, string, length, header, p_id, requested_port
+      ))) return 0;
+      return send_packet((char *)data, length);
+    };
+
+    void send_parts(
+      const PJON_Packet_Part *parts,
+      uint8_t count,
+      PJON_Bool<true>
+    ) {
+      typedef decltype(strategy.send_string(parts, count)) Result;
+      send_gathered(parts, count, PJON_Bool<PJON_Is_Bool<Result>::value>());
+    };
+
+    void send_gathered(
+      const PJON_Packet_Part *parts,
+      uint8_t count,
+      PJON_Bool<true>
+    ) {
+      if(!strategy.send_string(parts, count))
+        send_parts(parts, count, PJON_Bool<false>());
+    };
+
+    void send_gathered(
+      const PJON_Packet_Part *parts,
+      uint8_t count,
+      PJON_Bool<false>
+    ) {
+      strategy.send_string(parts, count);
+    };
+
+    void send_parts(
+      const PJON_Packet_Part *parts,
+      uint8_t count,
+      PJON_Bool<false>
+    ) {
+      uint16_t length = 0;
+      for(uint8_t i = 0; i < count; length += parts[i++].length)
+        memmove(data + length, parts[i].data, parts[i].length);
+      strategy.send_string(data, length);
+    };
+
+    /* Receive a whole frame in the packet's buffer if the strategy supports
+       it, returns its length, PJON_FAIL or 0 if bytes must be received with
+       receive_string: */
+
+    uint16_t receive_frame(PJON_Bool<true>) {
+      uint16_t frame_length = 0;
+      uint16_t result =
+        strategy.receive_frame(data, PacketMaxLength, frame_length);
+      if(result == PJON_FRAME_UNSUPPORTED) return 0;
+      if(result != PJON_ACK || !frame_length) return PJON_FAIL;
+      return frame_length;
+    };
+
+    uint16_t receive_frame(PJON_Bool<false>) { return 0; };
+
+    /* Let the strategy filter packets by receiver id if it supports it: */
+
+    void update_receiver_id(PJON_Bool<true>) {
+      strategy.set_receiver_id(_device_id, _router);
+    };
+
+    void update_receiver_id(PJON_Bool<false>) { };
+
+    /* Report a PacketMaxLength longer than the frames the strategy selected
+       at run time receives: */
+
+    void check_frame_limit(PJON_Bool<true>) {
+      if(PacketMaxLength > strategy.get_max_frame_length())
+        _error(PJON_CONTENT_TOO_LONG, PacketMaxLength, _custom_pointer);
+    };
+
+    void check_frame_limit(PJON_Bool<false>) { };
+
+    /* Transmit an already composed packet, what the strategy queues is
+       transmitted when it is flushed: */
+
+    uint16_t transmit_packet(const char *string, uint16_t length) {
+      if(!string) return PJON_FAIL;
+      if(_mode != PJON_SIMPLEX && !strategy.can_start()) return PJON_BUSY;
+      strategy.send_string((uint8_t *)string, length);
+      return transmission_result((const uint8_t *)string);
+    };
+
+    void flush(PJON_Bool<true>) { strategy.flush(); };
+
+    void flush(PJON_Bool<false>) { };
+
+    /* Get the result of the transmission of a packet beginning with head: */
+
+    uint16_t transmission_result(const uint8_t *head) {
+      if(
+        head[0] == PJON_BROADCAST ||
+        !(head[1] & PJON_ACK_REQ_BIT) ||
+        _mode == PJON_SIMPLEX
+      ) return PJON_ACK;
+      uint16_t response = strategy.receive_response();
+      if(
+        response == PJON_ACK ||
+        response == PJON_FAIL
+      ) return response;
+      else return PJON_BUSY;
+    };
+
+    /* Remove the packet i and call its completion function: */
+
+    void complete(PJON_Packet_Index i, uint16_t result) {
+      #if(PJON_INCLUDE_COMPLETION)
+        PJON_Completion completion = _packet_completion[i];
+        uint32_t latency = PJON_MICROS() - _packet_dispatched[i];
+        remove(i);
+        if(completion) completion(i, result, latency, _custom_pointer);
+      #else
+        (void)result;
+        remove(i);
+      #endif
+    };
+
+    /* Attempt the transmission of the packet i and update its state: */
+
+    void update_packet(PJON_Packet_Index i) {
+      uint8_t header = _packet_header[i];
+      bool async_ack =
+        (header & PJON_ACK_MODE_BIT) && (header & PJON_TX_INFO_BIT);
+      bool sync_ack = (header & PJON_ACK_REQ_BIT);
+
+      if(!(sync_ack && async_ack && _packet_state[i] == PJON_ACK))
+        _packet_state[i] = // Avoid resending sync-acked async ack packets
+          transmit_packet(packets[i].content, packets[i].length);
+
+      _packet_attempts[i]++;
+
+      if(_packet_state[i] == PJON_ACK) {
+        if(!_packet_timing[i]) {
+          if(
+            _auto_delete && (
+              (packets[i].length == packet_overhead(header) && async_ack) ||
+              !(header & PJON_ACK_MODE_BIT)
+            )
+          ) {
+            complete(i, PJON_ACK);
+            return;
+          }
+        } else {
+          if(!async_ack) {
+            _packet_attempts[i] = 0;
+            _packet_registration[i] = PJON_MICROS();
+            _packet_state[i] = PJON_TO_BE_SENT;
+          }
+        }
+        if(!async_ack) return;
+      }
+
+      if(_packet_state[i] != PJON_FAIL && _packet_state[i] != PJON_ACK)
+        strategy.handle_collision();
+
+      if(_packet_attempts[i] > strategy.get_max_attempts()) {
+        _error(PJON_CONNECTION_LOST, i, _custom_pointer);
+        if(!_packet_timing[i]) {
+          if(_auto_delete) complete(i, PJON_FAIL);
+        } else {
+          _packet_attempts[i] = 0;
+          _packet_registration[i] = PJON_MICROS();
+          _packet_state[i] = PJON_TO_BE_SENT;
+        }
+      }
+    };
+
+    #if(PJON_INDEX_PACKETS)
+      /* Packets index, the packet id is cached when dispatched: */
+
+      void index_packet(PJON_Packet_Index i) {
+        PJON_Packet_Info info;
+        parse((uint8_t *)packets[i].content, info);
+        _index.link(i, info.id, _packet_receiver[i]);
+      };
+
+      void link_index(PJON_Packet_Index i) {
+        _index.link(i, _index.id(i), _packet_receiver[i]);
+      };
+
+      void unindex_packet(PJON_Packet_Index i) {
+        _index.unlink(i, _packet_receiver[i]);
+      };
+    #endif
+
+    #if(PJON_INCLUDE_ASYNC_ACK || PJON_INCLUDE_PACKET_ID)
+      /* Recent packet ids are stored in recent_packet_ids in arrival order
+         and found through a linear probing hash table of their indexes: */
+
+      static bool record_equality(
+        const PJON_Packet_Record &a,
+        const PJON_Packet_Record &b
+      ) {
+        if(a.id != b.id || a.sender_id != b.sender_id) return false;
+        if((a.header & PJON_MODE_BIT) != (b.header & PJON_MODE_BIT))
+          return false;
+        return !(a.header & PJON_MODE_BIT) ||
+          PJONTools::bus_id_equality(a.sender_bus_id, b.sender_bus_id);
+      };
+
+      static uint32_t record_hash(const PJON_Packet_Record &record) {
+        uint32_t hash = ((uint32_t)record.id << 8) | record.sender_id;
+        if(record.header & PJON_MODE_BIT)
+          for(uint8_t i = 0; i < 4; i++)
+            hash = (hash ^ record.sender_bus_id[i]) * 16777619;
+        hash *= 2654435769UL;
+        return (hash ^ (hash >> 16)) & (PJON_RECENT_PACKET_ID_TABLE - 1);
+      };
+
+      /* Remove the record r from the table shifting back the records
+         following it in the same cluster, so no tombstone is needed: */
+
+      void forget_packet_id(PJON_Record_Index r) {
+        const uint32_t mask = PJON_RECENT_PACKET_ID_TABLE - 1;
+        uint32_t hole = record_hash(recent_packet_ids[r]);
+        while(_recent_packet_id_table[hole] != r) hole = (hole + 1) & mask;
+        for(uint32_t next = (hole + 1) & mask; ; next = (next + 1) & mask) {
+          PJON_Record_Index n = _recent_packet_id_table[next];
+          if(n == PJON_RECENT_PACKET_ID_NONE) break;
+          uint32_t home = record_hash(recent_packet_ids[n]);
+          // Skip records whose home is between the hole and their position
+          if(((next - home) & mask) < ((next - hole) & mask)) continue;
+          _recent_packet_id_table[hole] = n;
+          hole = next;
+        }
+        _recent_packet_id_table[hole] = PJON_RECENT_PACKET_ID_NONE;
+      };
+    #endif
+
+    /* Packets transmission schedule, a binary min-heap for each priority of
+       the slots in use ordered by the time their next transmission attempt
+       is due: */
+
+    uint8_t packet_priority(PJON_Packet_Index i) const {
+      #if(PJON_PRIORITIES > 1)
+        return _packet_priority[i];
+      #else
+        (void)i;
+        return 0;
+      #endif
+    };
+
+    bool packet_due(PJON_Packet_Index i, uint32_t now) const {
+      return (int32_t)(now - _packet_deadline[i]) >= 0;
+    };
+
+    #if(PJON_INCLUDE_COMPLETION)
+      bool packet_expired(PJON_Packet_Index i, uint32_t now) const {
+        return _packet_timeout[i] &&
+          ((uint32_t)(now - _packet_dispatched[i]) >= _packet_timeout[i]);
+      };
+
+      /* Bring the deadline forward so that the packet is visited when it
+         expires: */
+
+      void schedule_expiry(PJON_Packet_Index i) {
+        uint32_t expiry = _packet_dispatched[i] + _packet_timeout[i];
+        if(_packet_timeout[i] && !packet_due(i, expiry))
+          _packet_deadline[i] = expiry;
+      };
+    #endif
+
+    /* Packets due at the same time are sent in the order they were
+       dispatched, the clock may tick once per many dispatches: */
+
+    bool packet_earlier(PJON_Packet_Index a, PJON_Packet_Index b) const {
+      int32_t difference = (int32_t)(_packet_deadline[a] - _packet_deadline[b]);
+      if(difference) return difference < 0;
+      return (int16_t)(_packet_sequence[a] - _packet_sequence[b]) < 0;
+    };
+
+    /* Returns the priority to be served among the ones that have a packet
+       due, PJON_PRIORITIES if none has. In PJON_WEIGHTED_PRIORITY mode
+       they are selected by smooth weighted round-robin: each one gains its
+       weight, the one with most credit is served and pays the weights of
+       all the ones that were waiting: */
+
+    uint8_t due_priority(uint32_t now) {
+      uint8_t selected = PJON_PRIORITIES;
+      int16_t weights = 0;
+      for(uint8_t p = 0; p < PJON_PRIORITIES; p++) {
+        if(!_schedule_length[p] || !packet_due(_schedule[p][0], now))
+          continue;
+        if(_priority_mode == PJON_STRICT_PRIORITY) return p;
+        _priority_credit[p] += _priority_weight[p];
+        weights += _priority_weight[p];
+        if(
+          (selected == PJON_PRIORITIES) ||
+          (_priority_credit[p] > _priority_credit[selected])
+        ) selected = p;
+      }
+      if(selected < PJON_PRIORITIES) _priority_credit[selected] -= weights;
+      return selected;
+    };
+
+    void schedule_packet(PJON_Packet_Index i, uint32_t now, uint32_t min = 0) {
+      uint32_t elapsed = now - _packet_registration[i];
+      uint32_t delay =
+        _packet_timing[i] + strategy.back_off(_packet_attempts[i]);
+      uint32_t remaining = 0;
+      if(elapsed <= delay) { // Clamped to keep deadlines comparable
+        remaining = delay - elapsed;
+        if(remaining > 0x7FFFFFFE) remaining = 0x7FFFFFFE;
+        remaining++;
+      }
+      _packet_deadline[i] = now + ((remaining < min) ? min : remaining);
+      #if(PJON_INCLUDE_COMPLETION)
+        schedule_expiry(i);
+      #endif
+      if(_schedule_position[i] != PJON_PACKET_INDEX_NONE)
+        sift_packet(i, _schedule_position[i]);
+      else insert_packet(i);
+    };
+
+    void insert_packet(PJON_Packet_Index i) {
+      _scheduled_packets++;
+      sift_packet(i, _schedule_length[packet_priority(i)]++);
+    };
+
+    void unschedule_packet(PJON_Packet_Index i) {
+      uint8_t p = packet_priority(i);
+      PJON_Packet_Index position = _schedule_position[i];
+      PJON_Packet_Index last = _schedule[p][--_schedule_length[p]];
+      _scheduled_packets--;
+      _schedule_position[i] = PJON_PACKET_INDEX_NONE;
+      if(last != i) sift_packet(last, position);
+    };
+
+    void sift_packet(PJON_Packet_Index i, PJON_Packet_Index position) {
+      uint8_t p = packet_priority(i);
+      PJON_Packet_Index length = _schedule_length[p];
+      uint32_t next;
+      while(position) {
+        next = (position - 1) / 2;
+        if(!packet_earlier(i, _schedule[p][next])) break;
+        _schedule[p][position] = _schedule[p][next];
+        _schedule_position[_schedule[p][position]] = position;
+        position = next;
+      }
+      while((next = 2 * position + 1) < length) {
+        if(
+          ((next + 1) < length) &&
+          packet_earlier(_schedule[p][next + 1], _schedule[p][next])
+        ) next++;
+        if(!packet_earlier(_schedule[p][next], i)) break;
+        _schedule[p][position] = _schedule[p][next];
+        _schedule_position[_schedule[p][position]] = position;
+        position = next;
+      }
+      _schedule[p][position] = i;
+      _schedule_position[i] = position;
+    };
+
+    PJON_Packet_Index _first_packet;
+    PJON_Packet_Index _free_packet;
+    PJON_Packet_Index _last_packet;
+    PJON_Packet_Index _next_packet[MaxPackets];
+    PJON_Packet_Index _previous_packet[MaxPackets];
+    /* Packets' state and scheduling, apart from their content: */
+    uint16_t      _packet_state[MaxPackets];
+    uint32_t      _packet_deadline[MaxPackets];
+    uint16_t      _packet_sequence[MaxPackets];
+    uint16_t      _dispatch_sequence = 0;
+    uint8_t       _packet_attempts[MaxPackets];
+    uint8_t       _packet_header[MaxPackets];
+    uint8_t       _packet_receiver[MaxPackets];
+    uint32_t      _packet_registration[MaxPackets];
+    uint32_t      _packet_timing[MaxPackets];
+    PJON_Packet_Index _schedule[PJON_PRIORITIES][MaxPackets];
+    PJON_Packet_Index _schedule_length[PJON_PRIORITIES];
+    PJON_Packet_Index _schedule_position[MaxPackets];
+    PJON_Packet_Index _scheduled_packets;
+    #if(PJON_PRIORITIES > 1)
+      uint8_t       _packet_priority[MaxPackets];
+    #endif
+    #if(PJON_INCLUDE_COMPLETION)
+      PJON_Completion _packet_completion[MaxPackets];
+      uint32_t      _packet_dispatched[MaxPackets];
+      uint32_t      _packet_timeout[MaxPackets];
+    #endif
+    int16_t       _priority_credit[PJON_PRIORITIES];
+    uint8_t       _priority_mode;
+    uint8_t       _priority_weight[PJON_PRIORITIES];
+    #if(PJON_INCLUDE_ASYNC_ACK || PJON_INCLUDE_PACKET_ID)
+      PJON_Record_Index _recent_packet_id_table[PJON_RECENT_PACKET_ID_TABLE];
+      PJON_Record_Index _recent_packet_id_head;
+      PJON_Record_Index _recent_packet_ids;
+    #endif
+    #if(PJON_INDEX_PACKETS)
+      PJON_Packets_Index<MaxPackets, PJON_Packet_Index> _index;
+    #endif
+    PJON_Packets_Buffer<BufferLength, PJON_Packet_Index> _buffer;
     bool          _auto_delete = true;
     void         *_custom_pointer;
     PJON_Error    _error;
@@ -79,11 +79,18 @@ limitations under the License. */
 #define PJON_SIMPLEX        150
 #define PJON_HALF_DUPLEX    151
 
+/* Priority modes */
+#define PJON_STRICT_PRIORITY   0
+#define PJON_WEIGHTED_PRIORITY 1
+
 /* Protocol symbols */
 #define PJON_ACK              6
 #define PJON_BUSY           666
 #define PJON_NAK             21
 
+/* Packet completion result if it was not delivered in time */
+#define PJON_TIMEOUT        667
+
 /* Dynamic addressing */
 #define PJON_ID_ACQUIRE     199
 #define PJON_ID_REQUEST     200
@@ -148,6 +155,20 @@ limitations under the License. */
   #define PJON_PACKET_MAX_LENGTH 50
 #endif
 
+/* Length in bytes of the buffer shared by the packets' content. If 0 each
+   packet has its own buffer of PJON_PACKET_MAX_LENGTH bytes, else each one
+   takes as many bytes as it is long plus PJON_Packets_Buffer's block head,
+   so the memory used is bounded by the bytes in flight instead */
+#ifndef PJON_PACKETS_BUFFER_LENGTH
+  #define PJON_PACKETS_BUFFER_LENGTH 0
+#endif
+
+/* Number of priority classes of the packets in buffer (up to 128), 0 is
+   the highest. Packets due for transmission are sent in priority order */
+#ifndef PJON_PRIORITIES
+  #define PJON_PRIORITIES 1
+#endif
+
 /* If set to false async ack feature is not included saving memory
    (it saves around 1kB of memory) */
 #ifndef PJON_INCLUDE_ASYNC_ACK
@@ -160,7 +181,20 @@ limitations under the License. */
   #define PJON_INCLUDE_PACKET_ID false
 #endif
 
-/* Maximum packet ids record kept in memory (to avoid duplicated exchanges) */
+/* If set to true a completion function and a timeout can be set for each
+   packet in buffer (it takes 10 bytes per packet on 8 bit MCUs) */
+#ifndef PJON_INCLUDE_COMPLETION
+  #define PJON_INCLUDE_COMPLETION false
+#endif
+
+/* With async ack packets in buffer are indexed by packet id and receiver id
+   so acknowledgements are matched without parsing each packet in buffer
+   (an instance that buffers no packet has an empty PJON_Packets_Index) */
+#define PJON_INDEX_PACKETS PJON_INCLUDE_ASYNC_ACK
+
+/* Maximum packet ids record kept in memory (to avoid duplicated exchanges)
+   Up to 65534, records are found through a hash table at least twice as
+   long, when full the oldest record is replaced */
 #ifndef PJON_MAX_RECENT_PACKET_IDS
   #define PJON_MAX_RECENT_PACKET_IDS 10
 #endif
@@ -178,13 +212,206 @@ limitations under the License. */
 /* Master reception time during LIST_ID broadcast (250 milliseconds) */
 #define PJON_LIST_IDS_TIME         250000
 
-struct PJON_Packet {
-  uint8_t  attempts;
-  char     content[PJON_PACKET_MAX_LENGTH];
+/* Packet buffer index, the smallest type able to address MaxPackets slots
+   plus the two values reserved by the free and active slot lists */
+template<bool Small>
+struct PJON_Index_Type { typedef uint8_t Type; };
+
+template<>
+struct PJON_Index_Type<false> { typedef uint16_t Type; };
+
+typedef PJON_Index_Type<(PJON_MAX_PACKETS < 254)>::Type PJON_Packet_Index;
+#define PJON_PACKET_INDEX_NONE ((PJON_Packet_Index)~0)
+#define PJON_PACKET_INDEX_FREE ((PJON_Packet_Index)(PJON_PACKET_INDEX_NONE - 1))
+
+/* Recent packet ids buffer index, PJON_RECENT_PACKET_ID_NONE marks the
+   empty positions of its hash table */
+#if(PJON_MAX_RECENT_PACKET_IDS < 255)
+  typedef uint8_t PJON_Record_Index;
+#else
+  typedef uint16_t PJON_Record_Index;
+#endif
+#define PJON_RECENT_PACKET_ID_NONE ((PJON_Record_Index)~0)
+#define PJON_RECENT_PACKET_ID_TABLE \
+  PJONTools::hash_table_length(PJON_MAX_RECENT_PACKET_IDS)
+
+/* Packet buffer slot, its state and scheduling are kept by PJON in arrays
+   apart so that update() does not have to read the content */
+template<uint16_t PacketMaxLength>
+struct PJON_Sized_Packet {
+  char     content[PacketMaxLength];
   uint16_t length;
-  uint32_t registration;
-  uint16_t state;
-  uint32_t timing;
+};
+
+typedef PJON_Sized_Packet<PJON_PACKET_MAX_LENGTH> PJON_Packet;
+
+/* Packet whose content is stored in a PJON_Packets_Buffer */
+struct PJON_Buffered_Packet {
+  char     *content;
+  uint16_t length;
+};
+
+template<uint16_t PacketMaxLength, bool Buffered>
+struct PJON_Packet_Type { typedef PJON_Sized_Packet<PacketMaxLength> Type; };
+
+template<uint16_t PacketMaxLength>
+struct PJON_Packet_Type<PacketMaxLength, true> {
+  typedef PJON_Buffered_Packet Type;
+};
+
+/* Buffer where packets' content is allocated in blocks as long as packets
+   are, each preceded by its length and the index of the packet. Blocks are
+   allocated at the end, when it is reached the blocks of the packets still
+   in use are moved to the beginning and their content pointers updated: */
+
+template<uint32_t Length, typename Index>
+struct PJON_Packets_Buffer {
+  static const uint8_t block_head = sizeof(uint16_t) + sizeof(Index);
+  uint8_t data[Length];
+  uint32_t end = 0;
+
+  /* Returns where to compose the packet in slot i, its current block if
+     in use and long enough, or NULL if there is not enough space: */
+
+  template<typename Packet>
+  char *allocate(
+    Packet *packets,
+    const Index *previous,
+    Index i,
+    uint16_t length,
+    Index free
+  ) {
+    if((previous[i] != free) && (block_length(packets[i].content) >= length))
+      return packets[i].content;
+    if((Length - end) < (uint32_t)(block_head + length))
+      compact(packets, previous, free);
+    if((Length - end) < (uint32_t)(block_head + length)) return NULL;
+    uint8_t *block = data + end;
+    memcpy(block, &length, sizeof(length));
+    memcpy(block + sizeof(length), &i, sizeof(i));
+    end += block_head + length;
+    return (char *)block + block_head;
+  };
+
+  /* Assign the block to the packet if it was composed, else release it: */
+
+  template<typename Packet>
+  void commit(Packet *packets, Index i, char *content, uint16_t length) {
+    if(content == packets[i].content) return;
+    if(length) packets[i].content = content;
+    else release(content);
+  };
+
+  /* Blocks of removed packets are reclaimed moving the others, the last
+     one is reclaimed immediately: */
+
+  void release(char *content) {
+    if(content + block_length(content) == (char *)data + end)
+      end = ((uint8_t *)content - block_head) - data;
+  };
+
+  void clear() { end = 0; };
+
+  uint16_t block_length(const char *content) const {
+    uint16_t length;
+    memcpy(&length, content - block_head, sizeof(length));
+    return length;
+  };
+
+  template<typename Packet>
+  void compact(Packet *packets, const Index *previous, Index free) {
+    uint32_t to = 0;
+    for(uint32_t from = 0; from < end;) {
+      uint8_t *block = data + from;
+      uint16_t length;
+      Index i;
+      memcpy(&length, block, sizeof(length));
+      memcpy(&i, block + sizeof(length), sizeof(i));
+      from += block_head + length;
+      if(
+        (previous[i] == free) ||
+        (packets[i].content != (char *)block + block_head)
+      ) continue;
+      if(data + to != block) memmove(data + to, block, block_head + length);
+      packets[i].content = (char *)data + to + block_head;
+      to += block_head + length;
+    }
+    end = to;
+  };
+};
+
+/* Without a shared buffer each packet is composed in its own: */
+
+template<typename Index>
+struct PJON_Packets_Buffer<0, Index> {
+  template<typename Packet>
+  char *allocate(Packet *packets, const Index *, Index i, uint16_t, Index) {
+    return packets[i].content;
+  };
+
+  template<typename Packet>
+  void commit(Packet *, Index, char *, uint16_t) { };
+
+  void release(char *) { };
+
+  void clear() { };
+};
+
+/* Index of the packets in buffer, slots in use are chained in buckets
+   selected by packet id and receiver id, the packet id is cached when the
+   packet is linked: */
+
+template<uint16_t Length, typename Index>
+struct PJON_Packets_Index {
+  Index    buckets[Length];
+  Index    next[Length];
+  uint16_t ids[Length];
+
+  Index &bucket(uint16_t id, uint8_t receiver_id) {
+    return buckets[(uint16_t)(id ^ ((uint16_t)receiver_id << 8)) % Length];
+  };
+
+  Index first(uint16_t id, uint8_t receiver_id) {
+    return bucket(id, receiver_id);
+  };
+
+  Index after(Index i) const { return next[i]; };
+
+  uint16_t id(Index i) const { return ids[i]; };
+
+  void link(Index i, uint16_t id, uint8_t receiver_id) {
+    ids[i] = id;
+    Index &first = bucket(id, receiver_id);
+    next[i] = first;
+    first = i;
+  };
+
+  void unlink(Index i, uint8_t receiver_id) {
+    Index *slot = &bucket(ids[i], receiver_id);
+    while(*slot != i) slot = &next[*slot];
+    *slot = next[i];
+  };
+
+  void clear() {
+    for(uint16_t i = 0; i < Length; i++) buckets[i] = (Index)~0;
+  };
+};
+
+/* An instance that buffers no packet has nothing to index: */
+
+template<typename Index>
+struct PJON_Packets_Index<0, Index> {
+  Index first(uint16_t, uint8_t) { return (Index)~0; };
+
+  Index after(Index) const { return (Index)~0; };
+
+  uint16_t id(Index) const { return 0; };
+
+  void link(Index, uint16_t, uint8_t) { };
+
+  void unlink(Index, uint8_t) { };
+
+  void clear() { };
 };
 
 struct PJON_Packet_Record {
@@ -206,6 +433,131 @@ struct PJON_Packet_Info {
   void *custom_pointer = NULL;
 };
 
+/* A packet can be transmitted in parts (fields preceding the payload,
+   payload and CRC) to avoid copying the payload in a buffer */
+struct PJON_Packet_Part {
+  const uint8_t *data;
+  uint16_t length;
+};
+
+/* Maximum length of the fields preceding the payload */
+#define PJON_PACKET_HEAD_MAX_LENGTH 18
+
+/* Maximum number of parts a packet is transmitted in */
+#define PJON_PACKET_MAX_PARTS 3
+
+/* Detect if a strategy can transmit a packet in parts defining:
+   void send_string(const PJON_Packet_Part *parts, uint8_t count) */
+template<typename Strategy>
+struct PJON_Gather {
+  template<typename S>
+  static char test(decltype(
+    ((S *)0)->send_string((const PJON_Packet_Part *)0, (uint8_t)0)
+  ) *);
+  template<typename S>
+  static long test(...);
+  static const bool value = sizeof(test<Strategy>(0)) == sizeof(char);
+};
+
+/* A strategy whose send_string passed in parts returns bool may decline a
+   packet returning false (Any and StrategyVariant do if the strategy in use
+   does not support it), PJON then sends it in one piece */
+template<typename T>
+struct PJON_Is_Bool { static const bool value = false; };
+
+template<>
+struct PJON_Is_Bool<bool> { static const bool value = true; };
+
+/* Detect if a strategy may queue what is sent defining:
+   void flush()
+   It is called after each packet sent without waiting for a response and
+   at the end of update(), so that queued packets are transmitted */
+template<typename Strategy>
+struct PJON_Flushing {
+  template<typename S>
+  static char test(decltype(((S *)0)->flush()) *);
+  template<typename S>
+  static long test(...);
+  static const bool value = sizeof(test<Strategy>(0)) == sizeof(char);
+};
+
+/* Detect if a strategy filters packets by receiver id defining:
+   void set_receiver_id(uint8_t id, bool router) */
+template<typename Strategy>
+struct PJON_Filtering {
+  template<typename S>
+  static char test(decltype(
+    ((S *)0)->set_receiver_id((uint8_t)0, false)
+  ) *);
+  template<typename S>
+  static long test(...);
+  static const bool value = sizeof(test<Strategy>(0)) == sizeof(char);
+};
+
+/* Detect if a strategy receives through file descriptors that can be waited
+   on (for example by PJON_Reactor) defining:
+   uint8_t get_fds(int *fds, uint8_t max_fds)
+   It returns the number of descriptors, or PJON_FDS_PENDING if data is
+   already buffered and can be received without waiting */
+template<typename Strategy>
+struct PJON_Pollable {
+  template<typename S>
+  static char test(decltype(((S *)0)->get_fds((int *)0, (uint8_t)0)) *);
+  template<typename S>
+  static long test(...);
+  static const bool value = sizeof(test<Strategy>(0)) == sizeof(char);
+};
+
+#define PJON_FDS_PENDING 0xFF
+
+/* Detect if a strategy receives a whole frame at once defining:
+   uint16_t receive_frame(uint8_t *frame, uint16_t max, uint16_t &length)
+   It returns PJON_ACK storing the frame's length, PJON_FAIL if no valid frame
+   is received or PJON_FRAME_UNSUPPORTED if bytes must be received with
+   receive_string (used by Any if the strategy it wraps does not define it) */
+template<typename Strategy>
+struct PJON_Framed {
+  template<typename S>
+  static char test(decltype(
+    ((S *)0)->receive_frame((uint8_t *)0, (uint16_t)0, *(uint16_t *)0)
+  ) *);
+  template<typename S>
+  static long test(...);
+  static const bool value = sizeof(test<Strategy>(0)) == sizeof(char);
+};
+
+#define PJON_FRAME_UNSUPPORTED 65534
+
+/* Detect if a strategy receives frames up to a maximum length defining:
+   static const uint16_t max_frame_length
+   A longer PacketMaxLength is refused at compile time */
+template<typename Strategy>
+struct PJON_Frame_Limit {
+  template<typename S>
+  static constexpr uint32_t limit(decltype(S::max_frame_length) *) {
+    return S::max_frame_length;
+  };
+  template<typename S>
+  static constexpr uint32_t limit(...) { return 0xFFFFFFFF; };
+  static const uint32_t value = limit<Strategy>(0);
+};
+
+/* Detect if the frame length limit is known only at run time (Any) defining:
+   uint32_t get_max_frame_length()
+   A longer PacketMaxLength is reported calling the error handler with
+   PJON_CONTENT_TOO_LONG in begin() */
+template<typename Strategy>
+struct PJON_Frame_Limited {
+  template<typename S>
+  static char test(decltype(((S *)0)->get_max_frame_length()) *);
+  template<typename S>
+  static long test(...);
+  static const bool value = sizeof(test<Strategy>(0)) == sizeof(char);
+};
+
+template<bool Value>
+struct PJON_Bool {};
+
 typedef void (* PJON_Receiver)(
   uint8_t *payload,
   uint16_t length,
@@ -230,7 +582,73 @@ static void PJON_dummy_error_handler(
   void *   // custom_pointer
 ) {};
 
+typedef void (* PJON_Completion)(
+  uint16_t handle,
+  uint16_t result,
+  uint32_t latency,
+  void *custom_pointer
+);
+
 struct PJONTools {
+  /* Length of an open addressing hash table holding up to n elements,
+     the smallest power of 2 greater than or equal to 2n: */
+
+  static constexpr uint32_t hash_table_length(uint32_t n, uint32_t l = 1) {
+    return (l >= (2 * n)) ? l : hash_table_length(n, l << 1);
+  };
+
+  /* Packet layout, the fields offsets and the overhead depend only on the
+     header so they are constant if the header is known at compile time: */
+
+  static constexpr uint8_t packet_overhead(uint8_t header) {
+    return (
+      (
+        (header & PJON_MODE_BIT) ?
+          (header & PJON_TX_INFO_BIT   ? 10 : 5) :
+          (header & PJON_TX_INFO_BIT   ?  2 : 1)
+      ) + (header & PJON_EXT_LEN_BIT   ?  2 : 1)
+        + (header & PJON_CRC_BIT       ?  4 : 1)
+        + (header & PJON_PORT_BIT      ?  2 : 0)
+        + (
+            (
+              (header & PJON_ACK_MODE_BIT) ||
+              (header & PJON_PACKET_ID_BIT)
+            ) ? 2 : 0
+          )
+        + 1 // Header
+        + 1 // Header CRC
+    );
+  };
+
+  static constexpr uint8_t crc_overhead(uint8_t header) {
+    return (header & PJON_CRC_BIT) ? 4 : 1;
+  };
+
+  static constexpr uint8_t bus_id_offset(uint8_t header) {
+    return (header & PJON_EXT_LEN_BIT) ? 5 : 4;
+  };
+
+  static constexpr uint8_t sender_id_offset(uint8_t header) {
+    return bus_id_offset(header) + (
+      (header & PJON_MODE_BIT) ? ((header & PJON_TX_INFO_BIT) ? 8 : 4) : 0
+    );
+  };
+
+  static constexpr bool packet_id_presence(uint8_t header) {
+    return (PJON_INCLUDE_ASYNC_ACK || PJON_INCLUDE_PACKET_ID) && (
+      ((header & PJON_ACK_MODE_BIT) && (header & PJON_TX_INFO_BIT)) ||
+      (header & PJON_PACKET_ID_BIT)
+    );
+  };
+
+  static constexpr uint8_t packet_id_offset(uint8_t header) {
+    return sender_id_offset(header) + ((header & PJON_TX_INFO_BIT) ? 1 : 0);
+  };
+
+  static constexpr uint8_t port_offset(uint8_t header) {
+    return packet_id_offset(header) + (packet_id_presence(header) ? 2 : 0);
+  };
+
   /* Copy a bus id: */
 
   static void copy_bus_id(uint8_t dest[], const uint8_t src[]) {
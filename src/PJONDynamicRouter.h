@@ -52,22 +52,24 @@ limitations under the License. */
 
 #include <PJONRouter.h>
 
-class PJONDynamicRouter : public PJONRouter {
+template<class Strategy>
+class PJONSimpleDynamicRouter : public PJONSimpleRouter<Strategy> {
 protected:
+  typedef PJONSimpleRouter<Strategy> Router;
 
   void add_sender_to_routing_table(
     const PJON_Packet_Info &packet_info,
     uint8_t sender_bus
   ) {
     uint8_t start_search = 0;
-    uint8_t found_bus = find_bus_with_id(
+    uint8_t found_bus = this->find_bus_with_id(
       packet_info.sender_bus_id,
       packet_info.sender_id,
       start_search
     );
     // Not found among attached buses or in routing table. Add to table.
     if(found_bus == PJON_NOT_ASSIGNED)
-      add(packet_info.sender_bus_id, sender_bus);
+      this->add(packet_info.sender_bus_id, sender_bus);
   };
 
   virtual void dynamic_receiver_function(
@@ -76,17 +78,40 @@ protected:
     const PJON_Packet_Info &packet_info
   ) {
     // Do standard routing but also add unknown remote buses to routing table
-    add_sender_to_routing_table(packet_info, current_bus);
-    PJONSwitch::dynamic_receiver_function(payload, length, packet_info);
+    add_sender_to_routing_table(packet_info, Router::current_bus);
+    PJONSimpleSwitch<Strategy>::dynamic_receiver_function(
+      payload,
+      length,
+      packet_info
+    );
   };
 
+public:
+  PJONSimpleDynamicRouter() { };
+
+  template<class Bus>
+  PJONSimpleDynamicRouter(
+    uint8_t bus_count,
+    Bus *buses[],
+    uint8_t default_gateway = PJON_NOT_ASSIGNED
+  ) : Router(bus_count, buses, default_gateway) { };
+
+};
+
+class PJONDynamicRouter : public PJONSimpleDynamicRouter<Any> {
 public:
   PJONDynamicRouter() { };
 
+  template<class Bus>
   PJONDynamicRouter(
     uint8_t bus_count,
-    PJONAny *buses[],
+    Bus *buses[],
     uint8_t default_gateway = PJON_NOT_ASSIGNED
-  ) : PJONRouter(bus_count, buses, default_gateway) { };
-
+  ) : PJONSimpleDynamicRouter<Any>(bus_count, buses, default_gateway) { };
 };
+
+/* Dynamic router using buses of the strategies listed, see StrategyVariant */
+
+template<typename... Strategies>
+using PJONVariantDynamicRouter =
+  PJONSimpleDynamicRouter<StrategyVariant<Strategies...>>;
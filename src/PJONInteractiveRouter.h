@@ -81,7 +81,7 @@ protected:
     // the packets receiver_id, the packet is for this device.)
     bool packet_is_for_me = (
       RouterClass::buses[RouterClass::current_bus]->device_id() != PJON_NOT_ASSIGNED &&
-      memcmp(RouterClass::buses[RouterClass::current_bus]->bus_id, packet_info.receiver_bus_id, 4) == 0 &&
+      memcmp(RouterClass::buses[RouterClass::current_bus]->get_bus_id(), packet_info.receiver_bus_id, 4) == 0 &&
       RouterClass::buses[RouterClass::current_bus]->device_id() == packet_info.receiver_id
     );
 
@@ -117,9 +117,10 @@ protected:
 
 public:
   PJONInteractiveRouter() : RouterClass() {}
+  template<class Bus>
   PJONInteractiveRouter(
     uint8_t bus_count,
-    PJONAny*buses[],
+    Bus *buses[],
     uint8_t default_gateway = PJON_NOT_ASSIGNED)
     : RouterClass(bus_count, buses, default_gateway) {}
 
@@ -19,6 +19,9 @@ It performs the same routing as the PJONSwitch for locally attached buses,
 but supports a static routing table to enable traversing multiple levels of
 buses.
 
+PJONSimpleRouter does the same for buses of a single strategy type, for
+example a StrategyVariant, as PJONSimpleSwitch does for PJONSwitch.
+
 The PJON project is entirely financed by contributions of people like you and
 its resources are solely invested to cover the development and maintenance
 costs, consider to make donation:
@@ -56,8 +59,10 @@ limitations under the License. */
   #define PJON_ROUTER_TABLE_SIZE 10
 #endif
 
-class PJONRouter : public PJONSwitch {
+template<class Strategy>
+class PJONSimpleRouter : public PJONSimpleSwitch<Strategy> {
 protected:
+  typedef PJONSimpleSwitch<Strategy> Switch;
   uint8_t remote_bus_ids[PJON_ROUTER_TABLE_SIZE][4];
   uint8_t remote_bus_via_attached_bus[PJON_ROUTER_TABLE_SIZE];
   uint8_t table_size = 0;
@@ -67,10 +72,10 @@ protected:
     const uint8_t device_id,
     uint8_t &start_bus
   ) {
-    uint8_t start = start_bus - bus_count;
+    uint8_t start = start_bus - Switch::bus_count;
     for(uint8_t i = start; i < table_size; i++) {
       if(PJONTools::bus_id_equality(bus_id, remote_bus_ids[i])) {
-        start_bus = bus_count + i + 1; // Continue searching for matches
+        start_bus = Switch::bus_count + i + 1; // Continue searching for matches
         return remote_bus_via_attached_bus[i]; // Explicit bus id match
       }
     }
@@ -85,15 +90,16 @@ protected:
   ) {
     // Search for a locally attached bus first
     uint8_t receiver_bus = PJON_NOT_ASSIGNED;
-    if(start_bus < bus_count) {
-      receiver_bus = find_attached_bus_with_id(bus_id, device_id, start_bus);
+    if(start_bus < Switch::bus_count) {
+      receiver_bus =
+        Switch::find_attached_bus_with_id(bus_id, device_id, start_bus);
       if(receiver_bus == PJON_NOT_ASSIGNED)
-        start_bus = bus_count; // Not found among attached
+        start_bus = Switch::bus_count; // Not found among attached
     }
     // Search in the routing table
     if(
       (receiver_bus == PJON_NOT_ASSIGNED) &&
-      (start_bus >= bus_count) &&
+      (start_bus >= Switch::bus_count) &&
       (start_bus != PJON_NOT_ASSIGNED)
     ) {
       receiver_bus = find_bus_in_table(bus_id, device_id, start_bus);
@@ -103,12 +109,14 @@ protected:
   };
 
 public:
-  PJONRouter() {};
-  PJONRouter(
+  PJONSimpleRouter() {};
+
+  template<class Bus>
+  PJONSimpleRouter(
     uint8_t bus_count,
-    PJONAny *buses[],
+    Bus *buses[],
     uint8_t default_gateway = PJON_NOT_ASSIGNED
-  ) : PJONSwitch(bus_count, buses, default_gateway) { };
+  ) : Switch(bus_count, buses, default_gateway) { };
 
   void add(const uint8_t bus_id[], uint8_t via_attached_bus) {
     if(table_size < PJON_ROUTER_TABLE_SIZE) {
@@ -118,3 +126,20 @@ public:
     }
   };
 };
+
+class PJONRouter : public PJONSimpleRouter<Any> {
+public:
+  PJONRouter() {};
+
+  template<class Bus>
+  PJONRouter(
+    uint8_t bus_count,
+    Bus *buses[],
+    uint8_t default_gateway = PJON_NOT_ASSIGNED
+  ) : PJONSimpleRouter<Any>(bus_count, buses, default_gateway) { };
+};
+
+/* Router using buses of the strategies listed, see StrategyVariant: */
+
+template<typename... Strategies>
+using PJONVariantRouter = PJONSimpleRouter<StrategyVariant<Strategies...>>;
@@ -55,18 +55,83 @@ limitations under the License. */
 #pragma once
 #include <PJON.h>
 
+/* Operations of a bus used by the switches, PJONBus implements them whatever
+   the length of its buffers so that buses sized differently can be attached
+   to the same switch. Each call handles a whole packet, the strategy is
+   still called directly by the bus: */
+
 template<class Strategy>
-class PJONBus : public PJON<Strategy> {
+class PJONBusBase {
 public:
+  uint32_t receive_time;
+  uint8_t segment_count, segment;
+
+  virtual void begin() = 0;
+  virtual uint8_t device_id() const = 0;
+  virtual const uint8_t *get_bus_id() const = 0;
+  virtual uint8_t get_fds(int *fds, uint8_t max_fds) = 0;
+  virtual uint16_t get_max_packets() const = 0;
+  /* Packet in buffer at index, or the last one sent without a buffer: */
+  virtual const uint8_t *get_packet(uint16_t index) const = 0;
+  virtual uint32_t next_deadline() const = 0;
+  virtual void parse(const uint8_t *packet, PJON_Packet_Info &info) const = 0;
+  virtual uint16_t receive() = 0;
+  virtual uint16_t receive(uint32_t duration) = 0;
+  virtual uint16_t send_from_id(
+    uint8_t sender_id,
+    const uint8_t *sender_bus_id,
+    uint8_t id,
+    const uint8_t *b_id,
+    const char *string,
+    uint16_t length,
+    uint8_t  header = PJON_NO_HEADER,
+    uint16_t p_id = 0,
+    uint16_t requested_port = PJON_BROADCAST
+  ) = 0;
+  virtual void send_response(uint8_t response) = 0;
+  virtual void set_custom_pointer(void *pointer) = 0;
+  virtual void set_error(PJON_Error e) = 0;
+  virtual void set_receiver(PJON_Receiver r) = 0;
+  virtual void set_router(bool state) = 0;
+  virtual uint16_t update() = 0;
+};
+
+/* Buses attached to a switch, the length of their buffers and the number of
+   packets they can buffer can be passed as template parameters:
+   PJONBus<ThroughSerial, 2, 64> serial_bus(bus_id_a, 1);
+   PJONBus<ThroughSerial, 10, 200> uplink(bus_id_b, 1);
+   PJONBusBase<ThroughSerial> *buses[] = {&serial_bus, &uplink};
+   PJONSimpleSwitch<ThroughSerial> router(2, buses); */
+
+template<
+  class Strategy,
+  uint16_t MaxPackets = PJON_MAX_PACKETS,
+  uint16_t PacketMaxLength = PJON_PACKET_MAX_LENGTH,
+  uint32_t BufferLength = PJON_PACKETS_BUFFER_LENGTH
+>
+class PJONBus :
+  public PJON<Strategy, MaxPackets, PacketMaxLength, BufferLength>,
+  public PJONBusBase<Strategy> {
+  typedef PJON<Strategy, MaxPackets, PacketMaxLength, BufferLength> Protocol;
+
+  uint8_t get_fds(int *fds, uint8_t max_fds, PJON_Bool<true>) {
+    return Protocol::strategy.get_fds(fds, max_fds);
+  };
+
+  uint8_t get_fds(int *, uint8_t, PJON_Bool<false>) { return 0; };
+
+public:
+  using Protocol::parse;
+
   PJONBus(
     const uint8_t id = PJON_NOT_ASSIGNED,
     const uint32_t receive_time_in = 1000,
     const uint8_t num_device_id_segments = 1,
     const uint8_t device_id_segment = 0
-  ) : PJON<Strategy>(id) {
-    receive_time = receive_time_in;
-    segment_count = num_device_id_segments;
-    segment = device_id_segment;
+  ) : Protocol(id) {
+    this->receive_time = receive_time_in;
+    this->segment_count = num_device_id_segments;
+    this->segment = device_id_segment;
   };
 
   PJONBus(
@@ -75,14 +140,76 @@ public:
     const uint32_t receive_time_in = 1000,
     const uint8_t num_device_id_segments = 1,
     const uint8_t device_id_segment = 0
-  ) : PJON<Strategy>(bus_id, id) {
-    receive_time = receive_time_in;
-    segment_count = num_device_id_segments;
-    segment = device_id_segment;
+  ) : Protocol(bus_id, id) {
+    this->receive_time = receive_time_in;
+    this->segment_count = num_device_id_segments;
+    this->segment = device_id_segment;
   }
 
-  uint32_t receive_time;
-  uint8_t segment_count, segment;
+  void begin() { Protocol::begin(); };
+
+  uint8_t device_id() const { return Protocol::device_id(); };
+
+  const uint8_t *get_bus_id() const { return Protocol::bus_id; };
+
+  uint8_t get_fds(int *fds, uint8_t max_fds) {
+    return get_fds(fds, max_fds, PJON_Bool<PJON_Pollable<Strategy>::value>());
+  };
+
+  uint16_t get_max_packets() const { return MaxPackets; };
+
+  const uint8_t *get_packet(uint16_t index) const {
+    if(!MaxPackets) return Protocol::data;
+    return (const uint8_t *)Protocol::packets[index].content;
+  };
+
+  uint32_t next_deadline() const { return Protocol::next_deadline(); };
+
+  void parse(const uint8_t *packet, PJON_Packet_Info &info) const {
+    Protocol::parse(packet, info);
+  };
+
+  uint16_t receive() { return Protocol::receive(); };
+
+  uint16_t receive(uint32_t duration) { return Protocol::receive(duration); };
+
+  uint16_t send_from_id(
+    uint8_t sender_id,
+    const uint8_t *sender_bus_id,
+    uint8_t id,
+    const uint8_t *b_id,
+    const char *string,
+    uint16_t length,
+    uint8_t  header = PJON_NO_HEADER,
+    uint16_t p_id = 0,
+    uint16_t requested_port = PJON_BROADCAST
+  ) {
+    return Protocol::send_from_id(
+      sender_id,
+      sender_bus_id,
+      id,
+      b_id,
+      string,
+      length,
+      header,
+      p_id,
+      requested_port
+    );
+  };
+
+  void send_response(uint8_t response) {
+    Protocol::strategy.send_response(response);
+  };
+
+  void set_custom_pointer(void *pointer) { Protocol::set_custom_pointer(pointer); };
+
+  void set_error(PJON_Error e) { Protocol::set_error(e); };
+
+  void set_receiver(PJON_Receiver r) { Protocol::set_receiver(r); };
+
+  void set_router(bool state) { Protocol::set_router(state); };
+
+  uint16_t update() { return Protocol::update(); };
 };
 
 #ifndef PJON_ROUTER_MAX_BUSES
@@ -95,11 +222,14 @@ protected:
   uint8_t bus_count = 0;
   uint8_t default_gateway = PJON_NOT_ASSIGNED;
   uint8_t current_bus = PJON_NOT_ASSIGNED;
-  PJONBus<Strategy> *buses[PJON_ROUTER_MAX_BUSES];
+  uint8_t first_source = 0; // Position of the first bus in the reactor
+  uint16_t min_packets = 0; // Packets buffered by the smallest bus
+  PJONBusBase<Strategy> *buses[PJON_ROUTER_MAX_BUSES];
 
+  template<class Bus>
   void connect(
     uint8_t bus_count_in,
-    PJONBus<Strategy> *buses_in[],
+    Bus *buses_in[],
     uint8_t default_gateway_in,
     void *custom_pointer,
     PJON_Receiver receiver,
@@ -110,6 +240,8 @@ protected:
     default_gateway = default_gateway_in;
     for(uint8_t i = 0; i < bus_count; i++) {
       buses[i] = buses_in[i];
+      if(!i || buses[i]->get_max_packets() < min_packets)
+        min_packets = buses[i]->get_max_packets();
       buses[i]->set_receiver(receiver);
       buses[i]->set_error(error);
       buses[i]->set_custom_pointer(custom_pointer);
@@ -123,7 +255,7 @@ protected:
     uint8_t &start_bus
   ) {
     for(uint8_t i=start_bus; i<bus_count; i++) {
-      if(PJONTools::bus_id_equality(bus_id, buses[i]->bus_id)) {
+      if(PJONTools::bus_id_equality(bus_id, buses[i]->get_bus_id())) {
         // Check if bus is segmented and if device belongs to bus's segment
         if(
           (buses[i]->segment_count <= 1) || // Not segmented
@@ -151,7 +283,7 @@ protected:
       (packet_info.header & PJON_ACK_REQ_BIT) &&
       (packet_info.receiver_id != PJON_BROADCAST)
     ) {
-      buses[sender_bus]->strategy.send_response(PJON_ACK);
+      buses[sender_bus]->send_response(PJON_ACK);
       ack_sent = true;
     }
 
@@ -172,11 +304,10 @@ protected:
       packet_info.port
     );
 
-    #if PJON_MAX_PACKETS == 0
     // Call error function explicitly, because that will not be done while sending
-    // when PJON_MAX_PACKETS=0.
-    if (result == PJON_FAIL) dynamic_error_function(PJON_CONNECTION_LOST, 0);
-    #endif
+    // when the bus has no packet buffer.
+    if (!buses[receiver_bus]->get_max_packets() && result == PJON_FAIL)
+      dynamic_error_function(PJON_CONNECTION_LOST, 0);
     current_bus = send_bus;
   }
 
@@ -208,12 +339,13 @@ protected:
     uint16_t length,
     const PJON_Packet_Info &packet_info
   ) {
+    const uint8_t localhost[4] = {0, 0, 0, 0};
     uint8_t start_search = 0;
     bool ack_sent = false; // Send ACK only once even if delivering copies to multiple buses
     do {
       uint8_t receiver_bus = find_bus_with_id((const uint8_t*)
           ((packet_info.header & PJON_MODE_BIT) != 0 ?
-          packet_info.receiver_bus_id : buses[0]->localhost),
+          packet_info.receiver_bus_id : localhost),
           packet_info.receiver_id, start_search
       );
 
@@ -230,12 +362,15 @@ protected:
   void dynamic_error_function(uint8_t code, uint16_t data) { }
 
 public:
-
   PJONSimpleSwitch() {};
 
+  /* Buses can be passed as an array of PJONBus of the same size, or of
+     PJONBusBase to attach buses sized differently: */
+
+  template<class Bus>
   PJONSimpleSwitch(
     uint8_t bus_count,
-    PJONBus<Strategy> *buses[],
+    Bus *buses[],
     uint8_t default_gateway = PJON_NOT_ASSIGNED
   ) {
     connect_buses(bus_count, buses, default_gateway);
@@ -249,16 +384,44 @@ public:
     for(current_bus = 0; current_bus < bus_count; current_bus++) {
       uint16_t code =
         buses[current_bus]->receive(buses[current_bus]->receive_time);
-      if(PJON_MAX_PACKETS < bus_count && code == PJON_ACK) break;
+      if(min_packets < bus_count && code == PJON_ACK) break;
     }
     for(current_bus = 0; current_bus < bus_count; current_bus++)
       buses[current_bus]->update();
     current_bus = PJON_NOT_ASSIGNED;
   };
 
+  /* Add the buses to a reactor (see PJON_Reactor), loop can then wait for a
+     bus to be readable or to have a packet due instead of polling them
+     (at most timeout microseconds): */
+
+  template<typename Reactor>
+  bool begin(Reactor &reactor) {
+    begin();
+    for(uint8_t i = 0; i < bus_count; i++) {
+      int16_t source = reactor.add(*buses[i]);
+      if(source == -1) return false;
+      if(i == 0) first_source = source;
+    }
+    return true;
+  };
+
+  template<typename Reactor>
+  void loop(Reactor &reactor, uint32_t timeout = 0xFFFFFFFF) {
+    reactor.wait(timeout);
+    for(current_bus = 0; current_bus < bus_count; current_bus++)
+      if(reactor.is_ready(first_source + current_bus))
+        reactor.receive(first_source + current_bus);
+    for(current_bus = 0; current_bus < bus_count; current_bus++)
+      if(reactor.is_due(first_source + current_bus))
+        reactor.update(first_source + current_bus);
+    current_bus = PJON_NOT_ASSIGNED;
+  };
+
+  template<class Bus>
   void connect_buses(
     uint8_t bus_count_in,
-    PJONBus<Strategy> *buses_in[],
+    Bus *buses_in[],
     uint8_t default_gateway_in = PJON_NOT_ASSIGNED
   ) {
     connect(
@@ -276,7 +439,7 @@ public:
   uint8_t get_callback_bus() const { return current_bus; }
   
   // Return one of the buses, in the same order as sent to the constructor
-  PJONBus<Strategy> &get_bus(const uint8_t ix) { return *(buses[ix]); }
+  PJONBusBase<Strategy> &get_bus(const uint8_t ix) { return *(buses[ix]); }
   
   static void receiver_function(
     uint8_t *payload,
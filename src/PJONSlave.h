@@ -98,7 +98,7 @@ class PJONSlave : public PJON<Strategy> {
       char msg = PJON_ID_ACQUIRE;
       char head =
         this->config | required_config | PJON_PORT_BIT;
-      this->_device_id = PJON_NOT_ASSIGNED;
+      this->set_id(PJON_NOT_ASSIGNED);
       uint8_t id = PJON_RANDOM(1, PJON_MAX_DEVICES);
 
       if(
@@ -119,7 +119,7 @@ class PJONSlave : public PJON<Strategy> {
         ) == PJON_ACK
       ) acquire_id_multi_master(limit++);
 
-      this->_device_id = id;
+      this->set_id(id);
       receive(PJON_RANDOM(PJON_ACQUIRE_ID_DELAY) * 1000);
 
       if(
@@ -187,7 +187,7 @@ class PJONSlave : public PJON<Strategy> {
         0,
         PJON_DYNAMIC_ADDRESSING_PORT
       ) == PJON_ACK) {
-        this->_device_id = PJON_NOT_ASSIGNED;
+        this->set_id(PJON_NOT_ASSIGNED);
         return true;
       }
       error(PJON_ID_ACQUISITION_FAIL, PJON_ID_NEGATE);
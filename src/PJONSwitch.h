@@ -87,9 +87,24 @@ class PJONSwitch : public PJONSimpleSwitch<Any> {
 public:
   PJONSwitch() : PJONSimpleSwitch<Any>() {};
 
+  template<class Bus>
   PJONSwitch(
     uint8_t bus_count,
-    PJONAny *bus_list[],
+    Bus *bus_list[],
     uint8_t default_gateway = PJON_NOT_ASSIGNED
-  ) : PJONSimpleSwitch<Any>(bus_count, (PJONBus<Any>**)bus_list, default_gateway) { };
+  ) : PJONSimpleSwitch<Any>(bus_count, bus_list, default_gateway) { };
 };
+
+/* Bus and switch using one of the strategies listed, selected at run time,
+   without virtual calls (see StrategyVariant):
+
+   PJONVariant<ThroughSerial, LocalUDP> serial_bus(bus_id_a, 1);
+   PJONVariant<ThroughSerial, LocalUDP> udp_bus(bus_id_b, 1);
+   PJONVariant<ThroughSerial, LocalUDP> *buses[] = {&serial_bus, &udp_bus};
+   PJONVariantSwitch<ThroughSerial, LocalUDP> router(2, buses); */
+
+template<typename... Strategies>
+using PJONVariant = PJONBus<StrategyVariant<Strategies...>>;
+
+template<typename... Strategies>
+using PJONVariantSwitch = PJONSimpleSwitch<StrategyVariant<Strategies...>>;
@@ -83,7 +83,7 @@ protected:
 
   bool is_vbus(const uint8_t bus_id[]) {
     return virtual_bus < RouterClass::bus_count &&
-           memcmp(RouterClass::buses[virtual_bus]->bus_id, bus_id, 4)==0;
+           memcmp(RouterClass::buses[virtual_bus]->get_bus_id(), bus_id, 4)==0;
   }
 
   void register_device_on_vbus(const uint8_t device_id, const uint8_t attached_bus) {
@@ -103,7 +103,7 @@ protected:
                            bool &ack_sent, const PJON_Packet_Info &packet_info) {
     // Override the base class send_packet to disable requesting and sending ACK
     // if the receiver's location is not registered.
-    bool disable_ack = unknown_device_location && is_vbus(RouterClass::buses[receiver_bus]->bus_id);
+    bool disable_ack = unknown_device_location && is_vbus(RouterClass::buses[receiver_bus]->get_bus_id());
     if (disable_ack) {
       PJON_Packet_Info info;
       memcpy(&info, &packet_info, sizeof info);
@@ -128,17 +128,13 @@ protected:
   void handle_send_error(uint8_t code, uint8_t packet) {
     // Find out which device id does not receive
     if (PJON_CONNECTION_LOST == code &&
-        is_vbus(RouterClass::buses[RouterClass::current_bus]->bus_id) &&
-        (packet < PJON_MAX_PACKETS || PJON_MAX_PACKETS == 0))
+        is_vbus(RouterClass::buses[RouterClass::current_bus]->get_bus_id()) &&
+        (packet < RouterClass::buses[RouterClass::current_bus]->get_max_packets() ||
+         RouterClass::buses[RouterClass::current_bus]->get_max_packets() == 0))
     {
       PJON_Packet_Info info;
-      #if PJON_MAX_PACKETS == 0
       RouterClass::buses[RouterClass::current_bus]->
-        parse((uint8_t *)(RouterClass::buses[RouterClass::current_bus]->data), info);
-      #else
-      RouterClass::buses[RouterClass::current_bus]->
-        parse((uint8_t *)(RouterClass::buses[RouterClass::current_bus]->packets[packet].content), info);
-      #endif
+        parse(RouterClass::buses[RouterClass::current_bus]->get_packet(packet), info);
       if (info.receiver_id < PJON_VIRTUALBUS_MAX_DEVICES && is_vbus(info.receiver_bus_id)) {
         // Unregister the device if we got an error trying to deliver to the attached
         // bus on which it is registered. This will step back from pointed delivery
@@ -183,9 +179,10 @@ protected:
 
 public:
   PJONVirtualBusRouter() : RouterClass() { init_vbus(); }
+  template<class Bus>
   PJONVirtualBusRouter(
     uint8_t bus_count,
-    PJONAny*buses[],
+    Bus *buses[],
     uint8_t default_gateway = PJON_NOT_ASSIGNED)
     : RouterClass(bus_count, buses, default_gateway) { init_vbus(); }
 
@@ -50,19 +50,27 @@ public:
     return PJON_FAIL;
   }
 
-  void send_string(uint8_t *string, uint16_t length, IPAddress remote_ip, uint16_t remote_port) {
-    if(length > 0) {
+  void send_string(const PJON_Packet_Part *parts, uint8_t count, IPAddress remote_ip, uint16_t remote_port) {
+    if(count) {
       udp.beginPacket(remote_ip, remote_port);
       #if defined(ESP32)
         udp.write((const unsigned char*) &_magic_header, 4);
       #else
         udp.write((const char*) &_magic_header, 4);
       #endif
-      udp.write(string, length);
+      for(uint8_t i = 0; i < count; i++)
+        udp.write(parts[i].data, parts[i].length);
       udp.endPacket();
     }
   }
 
+  void send_string(uint8_t *string, uint16_t length, IPAddress remote_ip, uint16_t remote_port) {
+    if(length > 0) {
+      const PJON_Packet_Part part = {string, length};
+      send_string(&part, 1, remote_ip, remote_port);
+    }
+  }
+
   void send_response(uint8_t response) {
     send_string(&response, 1, udp.remoteIP(), udp.remotePort());
   }
@@ -72,7 +80,19 @@ public:
     send_string(string, length, address, remote_port);
   }
 
+  void send_string(const PJON_Packet_Part *parts, uint8_t count, uint8_t remote_ip[], uint16_t remote_port) {
+    IPAddress address(remote_ip);
+    send_string(parts, count, address, remote_port);
+  }
+
   void send_string(uint8_t *string, uint16_t length) {
+    if(length > 0) {
+      const PJON_Packet_Part part = {string, length};
+      send_string(&part, 1);
+    }
+  }
+
+  void send_string(const PJON_Packet_Part *parts, uint8_t count) {
     // Broadcast on local subnet, global broadcast may not be accepted
     IPAddress broadcastIp;
 #ifdef PJON_ESP
@@ -81,9 +101,34 @@ public:
 #else
     broadcastIp = _broadcast;
 #endif
-    send_string(string, length, broadcastIp, _port);
+    send_string(parts, count, broadcastIp, _port);
+  }
+
+  void flush() { } // Datagrams are not queued
+
+  // The port is not shared, TTL and loopback are not configurable
+  void set_reuse_address(bool) { }
+  bool set_multicast_options(uint8_t, bool, const uint8_t * = NULL) {
+    return true;
   }
 
+  // Receive the datagrams sent to a multicast group (one group at a time)
+  bool join_group(const uint8_t *group_ip) {
+    IPAddress group(group_ip[0], group_ip[1], group_ip[2], group_ip[3]);
+  #if defined(ESP8266)
+    return udp.beginMulticast(WiFi.localIP(), group, _port);
+  #elif defined(PJON_ETHERNET2)
+    (void)group;
+    return false;
+  #else
+    return udp.beginMulticast(group, _port);
+  #endif
+  }
+
+  // Kernel receiver filtering is not available
+  void set_filter(bool) { }
+  void set_receiver_id(uint8_t, bool) { }
+
   void set_magic_header(uint32_t magic_header) { _magic_header = magic_header; }
 
   void get_sender(uint8_t *ip, uint16_t &port) {
@@ -20,6 +20,7 @@
 #pragma once
 
 #ifdef LINUX
+  #include <errno.h>
   #include <stdio.h>
   #include <stdint.h>
   #include <inttypes.h>
@@ -33,6 +34,8 @@
   #include <sys/types.h>
   #include <sys/stat.h>
 
+  #include "SerialHelper_POSIX.h"
+
   #include <chrono>
   #include <thread>
   #include <sstream>
@@ -83,6 +86,54 @@
     std::this_thread::sleep_for(std::chrono::milliseconds(delay_value_ms));
   };
 
+  /* Serial reception buffer ---------------------------------------------- */
+
+  /* Bytes received by a serial port opened with serialOpen are read in
+     blocks of up to PJON_SERIAL_BUFFER_LENGTH bytes, serialDataAvailable
+     and serialGetCharacter are then served from memory instead of issuing
+     two system calls for each byte. Define PJON_SERIAL_BUFFER_LENGTH 0 to
+     read one byte at a time. */
+
+  #ifndef PJON_SERIAL_BUFFER_LENGTH
+    #define PJON_SERIAL_BUFFER_LENGTH 4096
+  #endif
+
+  /* Maximum number of serial ports buffered at the same time, other ports
+     are read one byte at a time */
+  #ifndef PJON_SERIAL_MAX_BUFFERS
+    #define PJON_SERIAL_MAX_BUFFERS 4
+  #endif
+
+  #if(PJON_SERIAL_BUFFER_LENGTH > 0)
+    struct PJON_Serial_Buffer {
+      int fd = -1;
+      uint32_t head = 0;  // Position of the next byte to be read
+      uint32_t count = 0; // Number of bytes buffered
+      uint8_t data[PJON_SERIAL_BUFFER_LENGTH];
+    };
+
+    PJON_Serial_Buffer serial_buffers[PJON_SERIAL_MAX_BUFFERS];
+
+    PJON_Serial_Buffer *serialBuffer(const int fd) {
+      for(uint8_t b = 0; b < PJON_SERIAL_MAX_BUFFERS; b++)
+        if(serial_buffers[b].fd == fd) return &serial_buffers[b];
+      return NULL;
+    };
+
+    /* Read what is available, read does not block because FIONREAD reports
+       at least a byte and VMIN is 0: */
+
+    uint32_t serialFillBuffer(const int fd, PJON_Serial_Buffer *buffer) {
+      int available = 0;
+      if(ioctl(fd, FIONREAD, &available) == -1 || available <= 0) return 0;
+      ssize_t result = read(fd, buffer->data, PJON_SERIAL_BUFFER_LENGTH);
+      if(result <= 0) return 0;
+      buffer->head = 0;
+      buffer->count = result;
+      return buffer->count;
+    };
+  #endif
+
   /* Open serial port ----------------------------------------------------- */
 
   int serialOpen(const char *device, const int baud) {
@@ -145,25 +196,82 @@
     ioctl(fd, TIOCMSET, &state);
 
     usleep(10000);	// Sleep for 10 milliseconds
+    #if(PJON_SERIAL_BUFFER_LENGTH > 0)
+      // Reuse the buffer of a closed port that had the same descriptor
+      PJON_Serial_Buffer *buffer = serialBuffer(fd);
+      if(!buffer) buffer = serialBuffer(-1);
+      if(buffer) {
+        buffer->fd = fd;
+        buffer->head = 0;
+        buffer->count = 0;
+      }
+    #endif
     return fd;
   };
 
+  /* Close serial port and release its buffer ----------------------------- */
+
+  int serialClose(const int fd) {
+    #if(PJON_SERIAL_BUFFER_LENGTH > 0)
+      PJON_Serial_Buffer *buffer = serialBuffer(fd);
+      if(buffer) buffer->fd = -1;
+    #endif
+    return close(fd);
+  };
+
   /* Returns the number of bytes of data available to be read in the buffer */
 
   int serialDataAvailable(const int fd) {
+    #if(PJON_SERIAL_BUFFER_LENGTH > 0)
+      PJON_Serial_Buffer *buffer = serialBuffer(fd);
+      if(buffer) {
+        if(!buffer->count) serialFillBuffer(fd, buffer);
+        return buffer->count;
+      }
+    #endif
     int result = 0;
     ioctl(fd, FIONREAD, &result);
     return result;
   };
 
+  /* Returns the number of bytes already read from the port and buffered */
+
+  int serialDataBuffered(const int fd) {
+    #if(PJON_SERIAL_BUFFER_LENGTH > 0)
+      PJON_Serial_Buffer *buffer = serialBuffer(fd);
+      if(buffer) return buffer->count;
+    #else
+      (void)fd; // Avoid "unused parameter" warning
+    #endif
+    return 0;
+  };
+
 /* Reads a character from the serial buffer ------------------------------- */
 
   int serialGetCharacter(const int fd) {
+    #if(PJON_SERIAL_BUFFER_LENGTH > 0)
+      PJON_Serial_Buffer *buffer = serialBuffer(fd);
+      if(buffer) {
+        if(!buffer->count && !serialFillBuffer(fd, buffer)) return -1;
+        buffer->count--;
+        return buffer->data[buffer->head++];
+      }
+    #endif
     uint8_t result;
     if(read(fd, &result, 1) != 1) return -1;
     return ((int)result) & 0xFF;
   };
 
+  /* Discards data not transmitted and received, buffered data included */
+
+  int serialFlush(const int fd) {
+    #if(PJON_SERIAL_BUFFER_LENGTH > 0)
+      PJON_Serial_Buffer *buffer = serialBuffer(fd);
+      if(buffer) buffer->count = 0;
+    #endif
+    return tcflush(fd, TCIOFLUSH);
+  };
+
   /* Generic constants ---------------------------------------------------- */
 
   #ifndef A0
@@ -227,7 +335,19 @@
   #endif
 
   #ifndef PJON_SERIAL_FLUSH
-    #define PJON_SERIAL_FLUSH(S) tcflush(S, TCIOFLUSH)
+    #define PJON_SERIAL_FLUSH(S) serialFlush(S)
+  #endif
+
+  #ifndef PJON_SERIAL_WRITE_STRING
+    #define PJON_SERIAL_WRITE_STRING(S, D, L) serialWriteString(S, D, L)
+  #endif
+
+  #ifndef PJON_SERIAL_DRAIN
+    #define PJON_SERIAL_DRAIN(S) serialDrain(S)
+  #endif
+
+  #ifndef PJON_SERIAL_BUFFERED
+    #define PJON_SERIAL_BUFFERED(S) serialDataBuffered(S)
   #endif
 
   /* Timing --------------------------------------------------------------- */
@@ -0,0 +1,302 @@
+#pragma once
+
+/* PJON_Reactor waits with epoll until one of the buses added to it can
+   receive, or until one of them has a packet due for transmission, so that
+   many buses can be served without polling them in turn.
+
+   The strategies that define get_fds (LocalUDP, GlobalUDP, EthernetTCP and
+   ThroughSerial on Linux) are waited on through their file descriptors, the
+   others are polled every PJON_REACTOR_POLL_INTERVAL microseconds.
+
+   PJON<LocalUDP> bus_a(44);
+   PJON<ThroughSerial> bus_b(44);
+   PJON_Reactor reactor;
+   reactor.add(bus_a);
+   reactor.add(bus_b);
+   while(true) reactor.loop(); */
+
+#include <PJONDefines.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+/* epoll_pwait2 waits with microseconds resolution (glibc 2.35 and
+   Linux 5.11 or later), epoll_wait with milliseconds resolution */
+#if defined(__GLIBC__) && !defined(PJON_REACTOR_PWAIT2)
+  #if __GLIBC_PREREQ(2, 35)
+    #define PJON_REACTOR_PWAIT2 true
+  #endif
+#endif
+#ifndef PJON_REACTOR_PWAIT2
+  #define PJON_REACTOR_PWAIT2 false
+#endif
+
+#ifndef PJON_REACTOR_MAX_SOURCES
+  #define PJON_REACTOR_MAX_SOURCES 16
+#endif
+
+/* Maximum number of file descriptors of each bus */
+#ifndef PJON_REACTOR_MAX_FDS
+  #define PJON_REACTOR_MAX_FDS 4
+#endif
+
+/* Interval in microseconds between receptions of buses without file
+   descriptors to wait on */
+#ifndef PJON_REACTOR_POLL_INTERVAL
+  #define PJON_REACTOR_POLL_INTERVAL 1000
+#endif
+
+/* Deadlines closer than this many microseconds are waited for sleeping as
+   long instead of spinning, a shorter sleep would last longer because of the
+   timer slack (define it lower to trade wake ups for latency) */
+#ifndef PJON_REACTOR_MIN_SLEEP
+  #define PJON_REACTOR_MIN_SLEEP 100
+#endif
+
+struct PJON_Reactor_Source {
+  void *bus;
+  uint8_t (*get_fds)(void *bus, int *fds, uint8_t max_fds);
+  uint16_t (*receive)(void *bus);
+  uint16_t (*update)(void *bus);
+  uint32_t (*next_deadline)(void *bus);
+  int fds[PJON_REACTOR_MAX_FDS];
+  uint8_t fd_count;
+  bool pending; // Data buffered by the strategy
+  bool hangup;  // A descriptor was found closed or in error by the last wait
+  bool ready;
+};
+
+class PJON_Reactor {
+  int _epoll = -1;
+  PJON_Reactor_Source _sources[PJON_REACTOR_MAX_SOURCES];
+  uint8_t _source_count = 0;
+  uint32_t _syscalls = 0;
+
+  template<typename Strategy>
+  static uint8_t strategy_fds(
+    Strategy &strategy,
+    int *fds,
+    uint8_t max_fds,
+    PJON_Bool<true>
+  ) {
+    return strategy.get_fds(fds, max_fds);
+  };
+
+  template<typename Strategy>
+  static uint8_t strategy_fds(Strategy &, int *, uint8_t, PJON_Bool<false>) {
+    return 0;
+  };
+
+  /* Buses attached to a switch (PJONBusBase) define get_fds themselves: */
+
+  template<typename Bus>
+  static uint8_t bus_fds(Bus *bus, int *fds, uint8_t max_fds, PJON_Bool<true>) {
+    return bus->get_fds(fds, max_fds);
+  };
+
+  template<typename Bus>
+  static uint8_t bus_fds(Bus *bus, int *fds, uint8_t max_fds, PJON_Bool<false>) {
+    typedef decltype(bus->strategy) Strategy;
+    return strategy_fds(
+      bus->strategy,
+      fds,
+      max_fds,
+      PJON_Bool<PJON_Pollable<Strategy>::value>()
+    );
+  };
+
+  template<typename Bus>
+  static uint8_t bus_fds(void *bus, int *fds, uint8_t max_fds) {
+    return bus_fds(
+      (Bus *)bus,
+      fds,
+      max_fds,
+      PJON_Bool<PJON_Pollable<Bus>::value>()
+    );
+  };
+
+  template<typename Bus>
+  static uint16_t bus_receive(void *bus) { return ((Bus *)bus)->receive(); };
+
+  template<typename Bus>
+  static uint16_t bus_update(void *bus) { return ((Bus *)bus)->update(); };
+
+  template<typename Bus>
+  static uint32_t bus_next_deadline(void *bus) {
+    return ((Bus *)bus)->next_deadline();
+  };
+
+  /* Register the file descriptors of the source that changed. If rearm is
+     true all are registered again, because a descriptor closed by the
+     strategy leaves epoll and its number may have been reused. It is done
+     after a hang up or an error only, so that a packet costs no epoll_ctl: */
+
+  void sync(uint8_t i, bool rearm) {
+    PJON_Reactor_Source &source = _sources[i];
+    int fds[PJON_REACTOR_MAX_FDS];
+    uint8_t count = source.get_fds(source.bus, fds, PJON_REACTOR_MAX_FDS);
+    source.pending = (count == PJON_FDS_PENDING);
+    if(source.pending) return; // Keep the descriptors registered
+    if(count > PJON_REACTOR_MAX_FDS) count = PJON_REACTOR_MAX_FDS;
+    bool changed = (count != source.fd_count);
+    for(uint8_t f = 0; !changed && f < count; f++)
+      changed = (fds[f] != source.fds[f]);
+    if(!changed && !rearm) return;
+    source.hangup = false;
+    for(uint8_t f = 0; f < source.fd_count; f++) {
+      bool kept = false;
+      for(uint8_t n = 0; !kept && n < count; n++) kept = (fds[n] == source.fds[f]);
+      if(!kept) {
+        _syscalls++;
+        epoll_ctl(_epoll, EPOLL_CTL_DEL, source.fds[f], NULL);
+      }
+    }
+    for(uint8_t f = 0; f < count; f++) {
+      bool known = false;
+      for(uint8_t n = 0; !known && n < source.fd_count; n++)
+        known = (source.fds[n] == fds[f]);
+      if(known && !rearm) continue;
+      struct epoll_event event;
+      event.events = EPOLLIN | EPOLLRDHUP;
+      event.data.u32 = i;
+      _syscalls++;
+      if(epoll_ctl(_epoll, EPOLL_CTL_MOD, fds[f], &event) == -1 && errno == ENOENT) {
+        _syscalls++;
+        epoll_ctl(_epoll, EPOLL_CTL_ADD, fds[f], &event);
+      }
+    }
+    for(uint8_t f = 0; f < count; f++) source.fds[f] = fds[f];
+    source.fd_count = count;
+  };
+
+  /* Wait with milliseconds resolution rounding up, so that a deadline
+     closer than a millisecond does not make the caller spin: */
+
+  int wait_ms(struct epoll_event *events, uint32_t timeout) {
+    _syscalls++;
+    return epoll_wait(
+      _epoll,
+      events,
+      PJON_REACTOR_MAX_SOURCES,
+      (timeout == 0xFFFFFFFF) ? -1 : (int)((timeout + 999) / 1000)
+    );
+  };
+
+public:
+  ~PJON_Reactor() {
+    if(_epoll != -1) close(_epoll);
+  };
+
+  /* Add a bus, returns its position (used by is_ready, receive and
+     update) or -1 if PJON_REACTOR_MAX_SOURCES buses are already added: */
+
+  template<typename Bus>
+  int16_t add(Bus &bus) {
+    if(_epoll == -1) _epoll = epoll_create1(EPOLL_CLOEXEC);
+    if(_epoll == -1 || _source_count == PJON_REACTOR_MAX_SOURCES) return -1;
+    PJON_Reactor_Source &source = _sources[_source_count];
+    source.bus = &bus;
+    source.get_fds = bus_fds<Bus>;
+    source.receive = bus_receive<Bus>;
+    source.update = bus_update<Bus>;
+    source.next_deadline = bus_next_deadline<Bus>;
+    source.fd_count = 0;
+    source.pending = false;
+    source.hangup = false;
+    source.ready = false;
+    sync(_source_count, true);
+    return _source_count++;
+  };
+
+  uint8_t get_source_count() const { return _source_count; };
+
+  // Number of epoll calls made to wait and register, for benchmarking
+  uint32_t get_syscall_count() const { return _syscalls; };
+
+  /* Wait until a bus can receive or has a packet due, at most timeout
+     microseconds, returns the number of buses that can receive: */
+
+  uint8_t wait(uint32_t timeout = 0xFFFFFFFF) {
+    for(uint8_t i = 0; i < _source_count; i++) {
+      PJON_Reactor_Source &source = _sources[i];
+      sync(i, false);
+      uint32_t deadline = source.next_deadline(source.bus);
+      if(deadline < timeout) timeout = deadline;
+      if(source.pending) timeout = 0;
+      else if(!source.fd_count && timeout > PJON_REACTOR_POLL_INTERVAL)
+        timeout = PJON_REACTOR_POLL_INTERVAL;
+      source.ready = source.pending || !source.fd_count;
+    }
+    if(timeout && timeout < PJON_REACTOR_MIN_SLEEP)
+      timeout = PJON_REACTOR_MIN_SLEEP;
+    struct epoll_event events[PJON_REACTOR_MAX_SOURCES];
+    int count;
+    #if(PJON_REACTOR_PWAIT2)
+      struct timespec time;
+      time.tv_sec = timeout / 1000000;
+      time.tv_nsec = (timeout % 1000000) * 1000;
+      _syscalls++;
+      count = epoll_pwait2(
+        _epoll,
+        events,
+        PJON_REACTOR_MAX_SOURCES,
+        (timeout == 0xFFFFFFFF) ? NULL : &time,
+        NULL
+      );
+      if(count == -1 && errno == ENOSYS) count = wait_ms(events, timeout);
+    #else
+      count = wait_ms(events, timeout);
+    #endif
+    for(int e = 0; e < count; e++)
+      if(events[e].data.u32 < _source_count) {
+        PJON_Reactor_Source &source = _sources[events[e].data.u32];
+        source.ready = true;
+        if(events[e].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+          source.hangup = true;
+      }
+    uint8_t ready = 0;
+    for(uint8_t i = 0; i < _source_count; i++) ready += _sources[i].ready;
+    return ready;
+  };
+
+  /* Check if the bus was found able to receive by the last wait: */
+
+  bool is_ready(uint8_t i) const {
+    return (i < _source_count) && _sources[i].ready;
+  };
+
+  /* Check if the bus has a packet due for transmission: */
+
+  bool is_due(uint8_t i) {
+    return (i < _source_count) &&
+      !_sources[i].next_deadline(_sources[i].bus);
+  };
+
+  /* Call receive or update on the bus, then register its file descriptors
+     if they changed or if one of them hung up: */
+
+  uint16_t receive(uint8_t i) {
+    uint16_t result = _sources[i].receive(_sources[i].bus);
+    sync(i, _sources[i].hangup);
+    return result;
+  };
+
+  uint16_t update(uint8_t i) {
+    uint16_t result = _sources[i].update(_sources[i].bus);
+    sync(i, _sources[i].hangup);
+    return result;
+  };
+
+  /* Wait, then receive from the buses that can receive and update the
+     buses that have a packet due: */
+
+  uint8_t loop(uint32_t timeout = 0xFFFFFFFF) {
+    uint8_t ready = wait(timeout);
+    for(uint8_t i = 0; i < _source_count; i++) {
+      if(_sources[i].ready) receive(i);
+      if(is_due(i)) update(i);
+    }
+    return ready;
+  };
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+/* Serial port writing shared by the Linux and Raspberry Pi interfaces, the
+   port is a file descriptor opened by serialOpen (or by WiringPi) */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+/* Milliseconds waited for room in the output queue before giving up */
+#ifndef PJON_SERIAL_WRITE_TIMEOUT
+  #define PJON_SERIAL_WRITE_TIMEOUT 1000
+#endif
+
+/* Interval in microseconds between checks of the output queue */
+#ifndef PJON_SERIAL_DRAIN_INTERVAL
+  #define PJON_SERIAL_DRAIN_INTERVAL 50
+#endif
+
+/* Writes length bytes with as few system calls as possible, if the output
+   queue is full waits until it has room: */
+
+int serialWriteString(const int fd, const uint8_t *data, uint16_t length) {
+  uint16_t written = 0;
+  while(written < length) {
+    ssize_t result = write(fd, data + written, length - written);
+    if(result > 0) written += result;
+    else if(result == -1 && errno == EAGAIN) {
+      struct pollfd output;
+      output.fd = fd;
+      output.events = POLLOUT;
+      output.revents = 0;
+      int ready = poll(&output, 1, PJON_SERIAL_WRITE_TIMEOUT);
+      if(!ready || (ready == -1 && errno != EINTR)) break;
+    } else if(result == -1 && errno != EINTR) break;
+  }
+  return written;
+};
+
+/* Waits until the data written is transmitted: */
+
+int serialDrain(const int fd) {
+  /* TIOCOUTQ is polled first because some USB adapters return from
+     tcdrain with a coarse resolution, tcdrain then waits for the
+     transmitter to be empty */
+  int queued = 0;
+  while(ioctl(fd, TIOCOUTQ, &queued) == 0 && queued > 0)
+    usleep(PJON_SERIAL_DRAIN_INTERVAL);
+  return tcdrain(fd);
+};
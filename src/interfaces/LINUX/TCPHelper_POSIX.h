@@ -17,6 +17,7 @@
 #include <unistd.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
@@ -252,6 +253,43 @@ public:
     return w;
   }
 
+  // Write the parts with a single gather call, up to PJON_PACKET_MAX_PARTS + 2
+  int write(const PJON_Packet_Part *parts, uint8_t count) {
+    if (_fd == -1 || count > PJON_PACKET_MAX_PARTS + 2) return -1;
+#ifdef _WIN32
+    WSABUF buffers[PJON_PACKET_MAX_PARTS + 2];
+    for (uint8_t i = 0; i < count; i++) {
+      buffers[i].buf = (char*)parts[i].data;
+      buffers[i].len = parts[i].length;
+    }
+    DWORD sent = 0;
+    int w = WSASend(_fd, buffers, count, &sent, 0, NULL, NULL) == 0 ? (int)sent : -1;
+#else
+    struct iovec vectors[PJON_PACKET_MAX_PARTS + 2];
+    for (uint8_t i = 0; i < count; i++) {
+      vectors[i].iov_base = (void*)parts[i].data;
+      vectors[i].iov_len = parts[i].length;
+    }
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = vectors;
+    message.msg_iovlen = count;
+    int w = ::sendmsg(_fd, &message, MSG_NOSIGNAL);
+#endif
+    if (w == -1) {
+      #ifdef ETCP_ERROR_PRINT
+#ifdef _WIN32
+      int errno2 = WSAGetLastError();
+      printf("write triggered stop, w=%d: %d\n", w, errno2);
+#else
+      if (errno != EPIPE) printf("write triggered stop, w=%d: %s\n", w, strerror(errno));
+#endif
+      #endif
+      stop();
+    }
+    return w;
+  }
+
   void flush() { }
 
   void stop() {
@@ -274,6 +312,7 @@ public:
   }
   bool operator!=(const TCPHelperClient& rhs) { return !this->operator==(rhs); }
   uint8_t getSocketNumber() { return _fd; }
+  int get_fd() const { return _fd; }
 
   int print(const char *msg) { return write((const uint8_t*) msg, strlen(msg)); }
 };
@@ -367,6 +406,7 @@ public:
   }
 
   void stop() { if (_fd != -1) { ::close(_fd); _fd = -1; } }
+  int get_fd() const { return _fd; }
 };
 
 #undef close
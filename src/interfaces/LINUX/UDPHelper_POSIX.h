@@ -14,17 +14,115 @@
 #include <unistd.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #endif
 
+#ifdef __linux__
+#include <linux/filter.h>
+#endif
+
+/* Batched datagram I/O (Linux only), define UDP_BATCH_SIZE greater than 1 to
+   receive up to UDP_BATCH_SIZE datagrams with a single recvmmsg call. Sent
+   datagrams are queued and sent with a single sendmmsg call when the queue is
+   full, before receiving, when a response is sent or when flush is called
+   (PJON calls it at the end of update() and after send_packet).
+   Each slot reserves UDP_BATCH_FRAME_LENGTH bytes, the packet and its 4 bytes
+   magic header, longer datagrams are sent directly but truncated receiving:
+   a PJON instance with a longer PacketMaxLength does not compile. */
+#ifndef UDP_BATCH_SIZE
+  #define UDP_BATCH_SIZE 1
+#endif
+#ifndef UDP_BATCH_FRAME_LENGTH
+  #define UDP_BATCH_FRAME_LENGTH (PJON_PACKET_MAX_LENGTH + 4)
+#endif
+#if (UDP_BATCH_SIZE > 1) && defined(__linux__)
+  #define UDP_BATCH true
+#else
+  #define UDP_BATCH false
+#endif
+
 class UDPHelper {
   uint16_t _port;
   uint32_t _magic_header;
   sockaddr_in _localaddr, _remote_receiver_addr, _remote_sender_addr;
   int _fd = -1;
+  uint32_t _syscalls = 0;
+  bool _reuse_address = false;
+  in_addr _multicast_interface;
+  bool _filter = false, _filter_any = true;
+  uint8_t _filter_id = 0;
+
+  // Attach (or detach) the receiver filter to the socket
+  bool apply_filter() {
+    if (_fd == -1) return false;
+#ifdef __linux__
+    if (!_filter) {
+      setsockopt(_fd, SOL_SOCKET, SO_DETACH_FILTER, NULL, 0);
+      return true;
+    }
+    /* The program sees the UDP header (8 bytes) followed by the datagram.
+       Accept it if the magic header matches and if it is a 1 byte response
+       or the receiver id is ours or broadcast (any id acting as router) */
+    struct sock_filter code[] = {
+      BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 8),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohl(_magic_header), 0, 6),
+      BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 8 + 4 + 1, 3, 0),
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 12),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, _filter_id, 1, 0),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, PJON_BROADCAST, 0, 1),
+      BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF), // Accept
+      BPF_STMT(BPF_RET | BPF_K, 0)           // Drop
+    };
+    if (_filter_any) code[2] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JA, 4, 0, 0);
+    struct sock_fprog program;
+    program.len = sizeof(code) / sizeof(code[0]);
+    program.filter = code;
+    return setsockopt(_fd, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) == 0;
+#else
+    return !_filter;
+#endif
+  }
+#if UDP_BATCH
+  // Received datagrams, consumed from _in_next
+  uint8_t _in_frame[UDP_BATCH_SIZE][UDP_BATCH_FRAME_LENGTH];
+  uint16_t _in_length[UDP_BATCH_SIZE];
+  sockaddr_in _in_addr[UDP_BATCH_SIZE];
+  uint8_t _in_next = 0, _in_count = 0;
+  // Queued datagrams, magic header included
+  uint8_t _out_frame[UDP_BATCH_SIZE][UDP_BATCH_FRAME_LENGTH];
+  uint16_t _out_length[UDP_BATCH_SIZE];
+  sockaddr_in _out_addr[UDP_BATCH_SIZE];
+  uint8_t _out_count = 0;
+
+  bool receive_batch() {
+    struct mmsghdr messages[UDP_BATCH_SIZE];
+    struct iovec vectors[UDP_BATCH_SIZE];
+    memset(messages, 0, sizeof(messages));
+    for (uint8_t i = 0; i < UDP_BATCH_SIZE; i++) {
+      vectors[i].iov_base = _in_frame[i];
+      vectors[i].iov_len = UDP_BATCH_FRAME_LENGTH;
+      messages[i].msg_hdr.msg_name = &_in_addr[i];
+      messages[i].msg_hdr.msg_namelen = sizeof(_in_addr[i]);
+      messages[i].msg_hdr.msg_iov = &vectors[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    _syscalls++;
+    // Wait for the first datagram (up to the receive timeout) only
+    int count = recvmmsg(_fd, messages, UDP_BATCH_SIZE, MSG_WAITFORONE, NULL);
+    if (count <= 0) return false;
+    for (uint8_t i = 0; i < count; i++)
+      _in_length[i] = (messages[i].msg_hdr.msg_flags & MSG_TRUNC) ? 0 : messages[i].msg_len;
+    _in_next = 0;
+    _in_count = count;
+    return true;
+  }
+#endif
 public:
   ~UDPHelper() {
+    flush();
     if (_fd != -1)
 #ifdef _WIN32
       closesocket(_fd);
@@ -43,6 +141,9 @@ public:
 	  if (iResult != 0) return false;
 #endif
     _port = port;
+#if UDP_BATCH
+    _in_count = _out_count = 0;
+#endif
 
     // Close if open after previous init attempt
     if (_fd != -1) {
@@ -56,6 +157,7 @@ public:
 
     // Prepare socket
     _fd=socket(AF_INET,SOCK_DGRAM, IPPROTO_UDP);
+    _multicast_interface.s_addr = INADDR_ANY;
     if (_fd==-1) {
       //printf("INIT listening socket %s\n", strerror(errno));
       return false;
@@ -71,6 +173,10 @@ public:
     #endif
     setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, (char *)&read_timeout, sizeof read_timeout);
 
+    // Let other processes on the host bind the same port (multicast)
+    int reuse = _reuse_address;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
     // Bind to specific local port
     memset(&_localaddr, 0, sizeof(_localaddr));
     _localaddr.sin_family = AF_INET;
@@ -94,64 +200,218 @@ public:
       //printf("INIT send setsockopt %s\n", strerror(errno));
       return false;
     }
+    if (_filter) apply_filter();
     return true;
   }
 
+  // Allow several sockets to bind the same port, call before begin
+  void set_reuse_address(bool reuse) { _reuse_address = reuse; }
+
+  // Set TTL, loopback and interface (any if NULL) of sent multicast datagrams
+  bool set_multicast_options(uint8_t ttl, bool loopback, const uint8_t *interface_ip = NULL) {
+    if (_fd == -1) return false;
+    _multicast_interface.s_addr = INADDR_ANY;
+    if (interface_ip) memcpy(&_multicast_interface.s_addr, interface_ip, 4);
+    int value = ttl;
+    if (setsockopt(_fd, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&value, sizeof(value)) == -1) return false;
+    value = loopback;
+    if (setsockopt(_fd, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*)&value, sizeof(value)) == -1) return false;
+#ifdef IP_MULTICAST_ALL
+    // Receive only the groups joined by this socket, not by the whole host
+    value = 0;
+    setsockopt(_fd, IPPROTO_IP, IP_MULTICAST_ALL, (const char*)&value, sizeof(value));
+#endif
+    return setsockopt(_fd, IPPROTO_IP, IP_MULTICAST_IF, (const char*)&_multicast_interface, sizeof(_multicast_interface)) == 0;
+  }
+
+  // Receive the datagrams sent to a multicast group
+  bool join_group(const uint8_t *group_ip) {
+    if (_fd == -1) return false;
+    struct ip_mreq request;
+    memcpy(&request.imr_multiaddr.s_addr, group_ip, 4);
+    request.imr_interface = _multicast_interface;
+    return setsockopt(_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&request, sizeof(request)) == 0;
+  }
+
+  // Drop in the kernel the datagrams not addressed to the receiver id (Linux)
+  void set_filter(bool enabled) {
+    _filter = enabled;
+    apply_filter();
+  }
+
+  // Set the receiver id accepted by the filter, any id is accepted if any
+  void set_receiver_id(uint8_t id, bool any) {
+    // A router accepts any id, its id changes while forwarding packets
+    bool changed = (any != _filter_any) || (!any && id != _filter_id);
+    _filter_id = id;
+    _filter_any = any;
+    if (changed && _filter) apply_filter();
+  }
+
   uint16_t receive_string(uint8_t *string, uint16_t max_length) {
+#if UDP_BATCH
+    flush();
+    if (!_in_count && !receive_batch()) return false; // Reception failed
+    uint8_t slot = _in_next++;
+    _in_count--;
+    // Remember sender's address
+    memcpy(&_remote_sender_addr, &_in_addr[slot], sizeof(_remote_sender_addr));
+    if (_in_length[slot] < 4) return false; // Truncated or too short
+    uint32_t header = 0;
+    memcpy(&header, _in_frame[slot], 4);
+    if (header != _magic_header) return false; // Not a LocalUDP packet
+    uint16_t length = _in_length[slot] - 4;
+    if (length >= max_length) return false; // Too large packet
+    memcpy(string, &_in_frame[slot][4], length);
+    return length;
+#else
+    // The magic header is read apart, the packet lands in string unshifted
     struct sockaddr_storage src_addr;
-    socklen_t src_addr_len=sizeof(src_addr);
-    ssize_t count=recvfrom(_fd,(char*)string,max_length,0,(struct sockaddr*)&src_addr,&src_addr_len);
+    uint32_t header = 0;
+    bool truncated = false;
+    _syscalls++;
+#ifdef _WIN32
+    WSABUF buffers[2];
+    buffers[0].buf = (char *)&header;
+    buffers[0].len = 4;
+    buffers[1].buf = (char *)string;
+    buffers[1].len = max_length;
+    DWORD received = 0, flags = 0;
+    int src_addr_len = sizeof(src_addr);
+    ssize_t count = WSARecvFrom(_fd, buffers, 2, &received, &flags, (struct sockaddr*)&src_addr, &src_addr_len, NULL, NULL) == 0 ? (ssize_t)received : -1;
+#else
+    struct iovec vectors[2];
+    vectors[0].iov_base = &header;
+    vectors[0].iov_len = 4;
+    vectors[1].iov_base = string;
+    vectors[1].iov_len = max_length;
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_name = &src_addr;
+    message.msg_namelen = sizeof(src_addr);
+    message.msg_iov = vectors;
+    message.msg_iovlen = 2;
+    ssize_t count = recvmsg(_fd, &message, 0);
+    truncated = message.msg_flags & MSG_TRUNC;
+#endif
     if (count==-1) {
 #ifdef _WIN32
 		//int error = WSAGetLastError();
 		//if (error != WSAETIMEDOUT) printf("recvfrom error %d, bufsize=%d\n", error, max_length);
 #endif
       return false; // Reception failed
-    } else if (count==max_length || count < 4) {
-      //printf("FAIL receive_string recvfrom %d\n", count);
+    } else if (truncated || count - 4 >= max_length || count < 4) {
+      //printf("FAIL receive_string recvmsg %d\n", count);
       return false; // Too large packet
     } else {
-      //printf("OK receive_string recvfrom %d, maxize %d\n", count, max_length);
       // Remember sender's address
       memcpy(&_remote_sender_addr, &src_addr, sizeof(_remote_sender_addr));
-
-      // Get header
-      uint32_t header = 0;
-      memcpy(&header, string, 4);
       if(header != _magic_header) return false; // Not a LocalUDP packet
-
-      // Shift contents to remove header
-      for (uint16_t i=0; i<count-4; i++) string[i] = string[i+4];
       return count - 4;
     }
     return PJON_FAIL;
+#endif
   }
 
-  class Buf {
-    char *buf = NULL;
-	uint16_t len = 0;
-  public:
-	  Buf(uint16_t size) { len = size;  buf = new char[size]; }
-    ~Buf() { if (buf) delete[] buf;  }
-    char* operator()() { return buf; }
-	uint16_t size() { return len; }
-  };
-
+  // Send the magic header followed by the parts with a single gather call
+  void send_string(const PJON_Packet_Part *parts, uint8_t count, const sockaddr_in &remote_addr) {
+    if(!count || count > PJON_PACKET_MAX_PARTS) return;
+#if UDP_BATCH
+    uint32_t length = 4;
+    for (uint8_t i = 0; i < count; i++) length += parts[i].length;
+    if (length <= UDP_BATCH_FRAME_LENGTH) {
+      if (_out_count == UDP_BATCH_SIZE) flush();
+      uint8_t *frame = _out_frame[_out_count];
+      memcpy(frame, &_magic_header, 4);
+      uint16_t offset = 4;
+      for (uint8_t i = 0; i < count; offset += parts[i++].length)
+        memcpy(frame + offset, parts[i].data, parts[i].length);
+      _out_length[_out_count] = length;
+      memcpy(&_out_addr[_out_count++], &remote_addr, sizeof(remote_addr));
+      return;
+    }
+    flush(); // Keep the order of queued datagrams
+#endif
+    _syscalls++;
+#ifdef _WIN32
+    WSABUF buffers[PJON_PACKET_MAX_PARTS + 1];
+    buffers[0].buf = (char *)&_magic_header;
+    buffers[0].len = 4;
+    for (uint8_t i = 0; i < count; i++) {
+      buffers[i + 1].buf = (char *)parts[i].data;
+      buffers[i + 1].len = parts[i].length;
+    }
+    DWORD sent = 0;
+    WSASendTo(_fd, buffers, count + 1, &sent, 0, (const sockaddr *)&remote_addr, sizeof(remote_addr), NULL, NULL);
+#else
+    struct iovec vectors[PJON_PACKET_MAX_PARTS + 1];
+    vectors[0].iov_base = &_magic_header;
+    vectors[0].iov_len = 4;
+    for (uint8_t i = 0; i < count; i++) {
+      vectors[i + 1].iov_base = (void *)parts[i].data;
+      vectors[i + 1].iov_len = parts[i].length;
+    }
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_name = (void *)&remote_addr;
+    message.msg_namelen = sizeof(remote_addr);
+    message.msg_iov = vectors;
+    message.msg_iovlen = count + 1;
+    sendmsg(_fd, &message, 0);
+#endif
+  }
 
   void send_string(const uint8_t *string, uint16_t length, const sockaddr_in &remote_addr) {
     if(length > 0) {
-      Buf buffer(4 + length);
-      memcpy(buffer(), &_magic_header, 4);
-      memcpy(&(buffer()[4]), string, length);
-      int res = sendto(_fd,buffer(),buffer.size(),0,(const sockaddr *)&remote_addr,sizeof(remote_addr));
-      //printf("send_string %d sendto %d\n", length, res);
+      const PJON_Packet_Part part = {string, length};
+      send_string(&part, 1, remote_addr);
     }
   }
 
   void send_response(uint8_t response) {
     send_string((const uint8_t *)&response, 1, _remote_sender_addr);
+    flush();
   }
 
+  // Send the queued datagrams, if any
+  void flush() {
+#if UDP_BATCH
+    if (!_out_count) return;
+    struct mmsghdr messages[UDP_BATCH_SIZE];
+    struct iovec vectors[UDP_BATCH_SIZE];
+    memset(messages, 0, sizeof(messages));
+    for (uint8_t i = 0; i < _out_count; i++) {
+      vectors[i].iov_base = _out_frame[i];
+      vectors[i].iov_len = _out_length[i];
+      messages[i].msg_hdr.msg_name = &_out_addr[i];
+      messages[i].msg_hdr.msg_namelen = sizeof(_out_addr[i]);
+      messages[i].msg_hdr.msg_iov = &vectors[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (uint8_t sent = 0; sent < _out_count;) {
+      _syscalls++;
+      int count = sendmmsg(_fd, &messages[sent], _out_count - sent, 0);
+      if (count <= 0) break;
+      sent += count;
+    }
+    _out_count = 0;
+#endif
+  }
+
+  // Descriptor to wait on, PJON_FDS_PENDING if datagrams are buffered or
+  // queued to be sent, receive_string sends them
+  uint8_t get_fds(int *fds, uint8_t max_fds) {
+#if UDP_BATCH
+    if (_in_count || _out_count) return PJON_FDS_PENDING;
+#endif
+    if (_fd == -1 || !max_fds) return 0;
+    fds[0] = _fd;
+    return 1;
+  }
+
+  // Number of socket calls made to send and receive, for benchmarking
+  uint32_t get_syscall_count() const { return _syscalls; }
+
   void send_string(const uint8_t *string, uint16_t length) {
 	_remote_receiver_addr.sin_port = htons(_port);
     _remote_receiver_addr.sin_addr.s_addr = INADDR_BROADCAST;
@@ -164,6 +424,18 @@ public:
     send_string(string, length, _remote_receiver_addr);
   }
 
+  void send_string(const PJON_Packet_Part *parts, uint8_t count) {
+	_remote_receiver_addr.sin_port = htons(_port);
+    _remote_receiver_addr.sin_addr.s_addr = INADDR_BROADCAST;
+    send_string(parts, count, _remote_receiver_addr);
+  }
+
+  void send_string(const PJON_Packet_Part *parts, uint8_t count, uint8_t *remote_ip, uint16_t remote_port) {
+	_remote_receiver_addr.sin_port = htons(remote_port);
+	_remote_receiver_addr.sin_addr.s_addr = *(uint32_t*)remote_ip;
+    send_string(parts, count, _remote_receiver_addr);
+  }
+
   void set_magic_header(uint32_t magic_header) { _magic_header = magic_header; }
 
   void get_sender(uint8_t *ip, uint16_t &port) {
@@ -25,6 +25,8 @@
   #include <wiringPi.h>
   #include <wiringSerial.h>
 
+  #include "../LINUX/SerialHelper_POSIX.h"
+
   /* Generic constants ---------------------------------------------------- */
 
   #ifndef A0
@@ -94,6 +96,16 @@
     #define PJON_SERIAL_FLUSH(S) serialFlush(S)
   #endif
 
+  /* Write a frame at once and wait until it is transmitted: */
+
+  #ifndef PJON_SERIAL_WRITE_STRING
+    #define PJON_SERIAL_WRITE_STRING(S, D, L) serialWriteString(S, D, L)
+  #endif
+
+  #ifndef PJON_SERIAL_DRAIN
+    #define PJON_SERIAL_DRAIN(S) serialDrain(S)
+  #endif
+
   /* Timing offset in microseconds between expected and real serial
      byte transmission: */
 
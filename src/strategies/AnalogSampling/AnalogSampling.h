@@ -259,8 +259,11 @@ class AnalogSampling {
 
     uint16_t receive_string(uint8_t *string, uint16_t max_length) {
       uint16_t result;
+      // Not a shorter max_length than before, a new frame starts
+      bool start = (max_length >= _max_length);
+      _max_length = max_length;
       // No initial flag, byte-stuffing violation
-      if(max_length == PJON_PACKET_MAX_LENGTH)
+      if(start)
         if(
           (receive_byte() != AS_START) ||
           (_last_byte == AS_ESC)
@@ -376,6 +379,7 @@ class AnalogSampling {
 
     uint16_t threshold = AS_THRESHOLD;
   private:
+    uint16_t _max_length = 0;
     uint8_t  _last_byte;
     uint16_t _analog_read_time;
     uint8_t  _input_pin;
@@ -25,6 +25,7 @@
 
 #include <strategies/Any/StrategyLinkBase.h>
 #include <strategies/Any/StrategyLink.h>
+#include <strategies/Any/StrategyVariant.h>
 
 class Any {
 public:
@@ -85,4 +86,46 @@ public:
     void send_string(uint8_t *string, uint16_t length) {
       s->send_string(string, length);
     }
+
+
+    /* Send a string passed in parts if the strategy supports it: */
+
+    bool send_string(const PJON_Packet_Part *parts, uint8_t count) {
+      return s->send_string(parts, count);
+    }
+
+
+    /* Receive a whole frame if the strategy supports it: */
+
+    uint16_t receive_frame(uint8_t *frame, uint16_t max, uint16_t &length) {
+      return s->receive_frame(frame, max, length);
+    }
+
+
+    /* File descriptors to wait on before receiving: */
+
+    uint8_t get_fds(int *fds, uint8_t max_fds) {
+      return s->get_fds(fds, max_fds);
+    }
+
+
+    /* Transmit what the strategy queued: */
+
+    void flush() {
+      s->flush();
+    }
+
+
+    /* Maximum length of the frames received by the strategy in use: */
+
+    uint32_t get_max_frame_length() {
+      return s->get_max_frame_length();
+    }
+
+
+    /* Let the strategy filter packets by receiver id if it supports it: */
+
+    void set_receiver_id(uint8_t id, bool router) {
+      s->set_receiver_id(id, router);
+    }
 };
@@ -76,4 +76,102 @@ public:
     void send_string(uint8_t *string, uint16_t length) {
       strategy.send_string(string, length);
     }
+
+
+    /* Send a string passed in parts if the strategy supports it: */
+
+    bool send_string(const PJON_Packet_Part *parts, uint8_t count) {
+      return send_string(
+        parts,
+        count,
+        PJON_Bool<PJON_Gather<Strategy>::value>()
+      );
+    }
+
+
+    /* File descriptors to wait on before receiving: */
+
+    uint8_t get_fds(int *fds, uint8_t max_fds) {
+      return get_fds(fds, max_fds, PJON_Bool<PJON_Pollable<Strategy>::value>());
+    }
+
+
+    /* Transmit what the strategy queued if it supports it: */
+
+    void flush() {
+      flush(PJON_Bool<PJON_Flushing<Strategy>::value>());
+    }
+
+
+    /* Maximum length of the frames received by the strategy: */
+
+    uint32_t get_max_frame_length() {
+      return PJON_Frame_Limit<Strategy>::value;
+    }
+
+
+    /* Let the strategy filter packets by receiver id if it supports it: */
+
+    void set_receiver_id(uint8_t id, bool router) {
+      set_receiver_id(
+        id,
+        router,
+        PJON_Bool<PJON_Filtering<Strategy>::value>()
+      );
+    }
+
+
+    /* Receive a whole frame if the strategy supports it: */
+
+    uint16_t receive_frame(uint8_t *frame, uint16_t max, uint16_t &length) {
+      return receive_frame(
+        frame,
+        max,
+        length,
+        PJON_Bool<PJON_Framed<Strategy>::value>()
+      );
+    }
+
+private:
+    uint8_t get_fds(int *fds, uint8_t max_fds, PJON_Bool<true>) {
+      return strategy.get_fds(fds, max_fds);
+    }
+
+    uint8_t get_fds(int *, uint8_t, PJON_Bool<false>) { return 0; }
+
+    void flush(PJON_Bool<true>) { strategy.flush(); }
+
+    void flush(PJON_Bool<false>) { }
+
+    void set_receiver_id(uint8_t id, bool router, PJON_Bool<true>) {
+      strategy.set_receiver_id(id, router);
+    }
+
+    void set_receiver_id(uint8_t, bool, PJON_Bool<false>) { }
+
+    uint16_t receive_frame(
+      uint8_t *frame,
+      uint16_t max,
+      uint16_t &length,
+      PJON_Bool<true>
+    ) {
+      return strategy.receive_frame(frame, max, length);
+    }
+
+    uint16_t receive_frame(uint8_t *, uint16_t, uint16_t &, PJON_Bool<false>) {
+      return PJON_FRAME_UNSUPPORTED;
+    }
+
+    bool send_string(
+      const PJON_Packet_Part *parts,
+      uint8_t count,
+      PJON_Bool<true>
+    ) {
+      strategy.send_string(parts, count);
+      return true;
+    }
+
+    bool send_string(const PJON_Packet_Part *, uint8_t, PJON_Bool<false>) {
+      return false;
+    }
 };
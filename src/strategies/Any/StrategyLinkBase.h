@@ -66,4 +66,39 @@ public:
     /* Send a string: */
 
     virtual void send_string(uint8_t *string, uint16_t length) = 0;
+
+
+    /* Send a string passed in parts (not supported by default, PJON then
+       sends it in one piece): */
+
+    virtual bool send_string(const PJON_Packet_Part *, uint8_t) {
+      return false;
+    }
+
+
+    /* Receive a whole frame (not supported by default): */
+
+    virtual uint16_t receive_frame(uint8_t *, uint16_t, uint16_t &) {
+      return PJON_FRAME_UNSUPPORTED;
+    }
+
+
+    /* File descriptors to wait on before receiving (none by default): */
+
+    virtual uint8_t get_fds(int *, uint8_t) { return 0; }
+
+
+    /* Transmit what the strategy queued (nothing by default): */
+
+    virtual void flush() { }
+
+
+    /* Maximum length of the frames received (unlimited by default): */
+
+    virtual uint32_t get_max_frame_length() { return 0xFFFFFFFF; }
+
+
+    /* Filter packets by receiver id (not supported by default): */
+
+    virtual void set_receiver_id(uint8_t, bool) { }
 };
@@ -0,0 +1,344 @@
+/* StrategyVariant
+   Let a PJON object use one of the strategies listed as template parameters,
+   selected at run time, as Any does but without StrategyLink objects and
+   virtual methods: each method compares the index of the selected strategy
+   and calls it. It is not measurably faster than Any where indirect calls
+   are predicted (see examples/LINUX/Benchmark/Variant), its strategies are
+   known at compile time instead, so that their optional methods and limits
+   (max_frame_length) are checked when PJON is compiled.
+
+   StrategyVariant holds an instance of each strategy, only the selected one
+   is used. Methods that are optional (get_fds, receive_frame, send_string
+   passed in parts, flush and set_receiver_id) are forwarded if the selected
+   strategy defines them.
+
+   PJON<StrategyVariant<ThroughSerial, LocalUDP>> bus;
+   bus.strategy.get<ThroughSerial>().set_serial(s);
+   bus.strategy.select<ThroughSerial>();
+   ___________________________________________________________________________
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License. */
+
+#pragma once
+
+template<typename Strategy>
+struct PJON_Type {};
+
+/* Each node holds a strategy and the rest of the list, the last one ends the
+   recursion and is never selected: */
+
+template<uint8_t Index, typename... Strategies>
+struct PJON_Variant_Node {
+  static const uint32_t frame_limit = 0xFFFFFFFF;
+  uint32_t back_off(uint8_t, uint8_t) { return 0; };
+  bool begin(uint8_t, uint8_t) { return false; };
+  bool can_start(uint8_t) { return false; };
+  uint8_t get_max_attempts(uint8_t) { return 0; };
+  void handle_collision(uint8_t) { };
+  uint16_t receive_string(uint8_t, uint8_t *, uint16_t) { return PJON_FAIL; };
+  uint16_t receive_response(uint8_t) { return PJON_FAIL; };
+  void send_response(uint8_t, uint8_t) { };
+  void send_string(uint8_t, uint8_t *, uint16_t) { };
+  bool send_string(uint8_t, const PJON_Packet_Part *, uint8_t) {
+    return false;
+  };
+  uint16_t receive_frame(uint8_t, uint8_t *, uint16_t, uint16_t &) {
+    return PJON_FRAME_UNSUPPORTED;
+  };
+  uint8_t get_fds(uint8_t, int *, uint8_t) { return 0; };
+  void flush(uint8_t) { };
+  void set_receiver_id(uint8_t, uint8_t, bool) { };
+};
+
+template<uint8_t Index, typename Strategy, typename... Rest>
+struct PJON_Variant_Node<Index, Strategy, Rest...> {
+  Strategy strategy;
+  PJON_Variant_Node<Index + 1, Rest...> rest;
+
+  // The shortest frame length limit of this strategy and of the next ones
+  static const uint32_t frame_limit =
+    (PJON_Frame_Limit<Strategy>::value <
+      PJON_Variant_Node<Index + 1, Rest...>::frame_limit) ?
+        PJON_Frame_Limit<Strategy>::value :
+        PJON_Variant_Node<Index + 1, Rest...>::frame_limit;
+
+  Strategy &get(PJON_Type<Strategy>) { return strategy; };
+
+  template<typename S>
+  S &get(PJON_Type<S> type) { return rest.get(type); };
+
+  static uint8_t index(PJON_Type<Strategy>) { return Index; };
+
+  template<typename S>
+  static uint8_t index(PJON_Type<S> type) {
+    return PJON_Variant_Node<Index + 1, Rest...>::index(type);
+  };
+
+  uint32_t back_off(uint8_t i, uint8_t attempts) {
+    if(i == Index) return strategy.back_off(attempts);
+    return rest.back_off(i, attempts);
+  };
+
+  bool begin(uint8_t i, uint8_t additional_randomness) {
+    if(i == Index) return strategy.begin(additional_randomness);
+    return rest.begin(i, additional_randomness);
+  };
+
+  bool can_start(uint8_t i) {
+    if(i == Index) return strategy.can_start();
+    return rest.can_start(i);
+  };
+
+  uint8_t get_max_attempts(uint8_t i) {
+    if(i == Index) return strategy.get_max_attempts();
+    return rest.get_max_attempts(i);
+  };
+
+  void handle_collision(uint8_t i) {
+    if(i == Index) strategy.handle_collision();
+    else rest.handle_collision(i);
+  };
+
+  uint16_t receive_string(uint8_t i, uint8_t *string, uint16_t max_length) {
+    if(i == Index) return strategy.receive_string(string, max_length);
+    return rest.receive_string(i, string, max_length);
+  };
+
+  uint16_t receive_response(uint8_t i) {
+    if(i == Index) return strategy.receive_response();
+    return rest.receive_response(i);
+  };
+
+  void send_response(uint8_t i, uint8_t response) {
+    if(i == Index) strategy.send_response(response);
+    else rest.send_response(i, response);
+  };
+
+  void send_string(uint8_t i, uint8_t *string, uint16_t length) {
+    if(i == Index) strategy.send_string(string, length);
+    else rest.send_string(i, string, length);
+  };
+
+  bool send_string(uint8_t i, const PJON_Packet_Part *parts, uint8_t count) {
+    if(i == Index)
+      return send_string(
+        parts,
+        count,
+        PJON_Bool<PJON_Gather<Strategy>::value>()
+      );
+    return rest.send_string(i, parts, count);
+  };
+
+  uint16_t receive_frame(
+    uint8_t i,
+    uint8_t *frame,
+    uint16_t max,
+    uint16_t &length
+  ) {
+    if(i == Index)
+      return receive_frame(
+        frame,
+        max,
+        length,
+        PJON_Bool<PJON_Framed<Strategy>::value>()
+      );
+    return rest.receive_frame(i, frame, max, length);
+  };
+
+  uint8_t get_fds(uint8_t i, int *fds, uint8_t max_fds) {
+    if(i == Index)
+      return get_fds(fds, max_fds, PJON_Bool<PJON_Pollable<Strategy>::value>());
+    return rest.get_fds(i, fds, max_fds);
+  };
+
+  void flush(uint8_t i) {
+    if(i == Index) flush(PJON_Bool<PJON_Flushing<Strategy>::value>());
+    else rest.flush(i);
+  };
+
+  void set_receiver_id(uint8_t i, uint8_t id, bool router) {
+    if(i == Index)
+      set_receiver_id(
+        id,
+        router,
+        PJON_Bool<PJON_Filtering<Strategy>::value>()
+      );
+    else rest.set_receiver_id(i, id, router);
+  };
+
+  uint16_t receive_frame(
+    uint8_t *frame,
+    uint16_t max,
+    uint16_t &length,
+    PJON_Bool<true>
+  ) {
+    return strategy.receive_frame(frame, max, length);
+  };
+
+  uint16_t receive_frame(uint8_t *, uint16_t, uint16_t &, PJON_Bool<false>) {
+    return PJON_FRAME_UNSUPPORTED;
+  };
+
+  bool send_string(
+    const PJON_Packet_Part *parts,
+    uint8_t count,
+    PJON_Bool<true>
+  ) {
+    strategy.send_string(parts, count);
+    return true;
+  };
+
+  bool send_string(const PJON_Packet_Part *, uint8_t, PJON_Bool<false>) {
+    return false;
+  };
+
+  uint8_t get_fds(int *fds, uint8_t max_fds, PJON_Bool<true>) {
+    return strategy.get_fds(fds, max_fds);
+  };
+
+  uint8_t get_fds(int *, uint8_t, PJON_Bool<false>) { return 0; };
+
+  void flush(PJON_Bool<true>) { strategy.flush(); };
+
+  void flush(PJON_Bool<false>) { };
+
+  void set_receiver_id(uint8_t id, bool router, PJON_Bool<true>) {
+    strategy.set_receiver_id(id, router);
+  };
+
+  void set_receiver_id(uint8_t, bool, PJON_Bool<false>) { };
+};
+
+template<typename... Strategies>
+class StrategyVariant {
+  PJON_Variant_Node<0, Strategies...> _node;
+  uint8_t _selected = 0;
+
+public:
+    /* Frames are limited to the shortest limit of the strategies, so that
+       PJON refuses a longer PacketMaxLength whatever strategy is selected: */
+
+    static const uint32_t max_frame_length =
+      PJON_Variant_Node<0, Strategies...>::frame_limit;
+
+
+    /* Get the instance of a strategy, to configure it: */
+
+    template<typename S>
+    S &get() { return _node.get(PJON_Type<S>()); }
+
+
+    /* Select the strategy to be used (the first one by default): */
+
+    template<typename S>
+    S &select() {
+      _selected = PJON_Variant_Node<0, Strategies...>::index(PJON_Type<S>());
+      return get<S>();
+    }
+
+
+    /* Returns the position of the selected strategy in the list: */
+
+    uint8_t get_selected() const { return _selected; }
+
+
+    /* Returns delay related to the attempts passed as parameter: */
+
+    uint32_t back_off(uint8_t attempts) {
+      return _node.back_off(_selected, attempts);
+    }
+
+
+    /* Begin method, to be called before transmission or reception: */
+
+    bool begin(uint8_t additional_randomness = 0) {
+      return _node.begin(_selected, additional_randomness);
+    }
+
+
+    /* Check if the channel is free for transmission */
+
+    bool can_start() { return _node.can_start(_selected); }
+
+
+    /* Returns the maximum number of attempts for each transmission: */
+
+    uint8_t get_max_attempts() { return _node.get_max_attempts(_selected); }
+
+
+    /* Handle a collision: */
+
+    void handle_collision() { _node.handle_collision(_selected); };
+
+
+    /* Receive a string: */
+
+    uint16_t receive_string(uint8_t *string, uint16_t max_length) {
+      return _node.receive_string(_selected, string, max_length);
+    }
+
+
+    /* Receive byte response: */
+
+    uint16_t receive_response() { return _node.receive_response(_selected); }
+
+
+    /* Send byte response to package transmitter: */
+
+    void send_response(uint8_t response) {
+      _node.send_response(_selected, response);
+    }
+
+
+    /* Send a string: */
+
+    void send_string(uint8_t *string, uint16_t length) {
+      _node.send_string(_selected, string, length);
+    }
+
+
+    /* Send a string passed in parts, returns false if the selected
+       strategy does not support it, PJON then sends it in one piece: */
+
+    bool send_string(const PJON_Packet_Part *parts, uint8_t count) {
+      return _node.send_string(_selected, parts, count);
+    }
+
+
+    /* Receive a whole frame if the strategy supports it: */
+
+    uint16_t receive_frame(uint8_t *frame, uint16_t max, uint16_t &length) {
+      return _node.receive_frame(_selected, frame, max, length);
+    }
+
+
+    /* File descriptors to wait on before receiving: */
+
+    uint8_t get_fds(int *fds, uint8_t max_fds) {
+      return _node.get_fds(_selected, fds, max_fds);
+    }
+
+
+    /* Transmit what the strategy queued if it supports it: */
+
+    void flush() {
+      _node.flush(_selected);
+    }
+
+
+    /* Let the strategy filter packets by receiver id if it supports it: */
+
+    void set_receiver_id(uint8_t id, bool router) {
+      _node.set_receiver_id(_selected, id, router);
+    }
+};
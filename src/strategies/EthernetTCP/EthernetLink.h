@@ -125,6 +125,8 @@
 
 #pragma once
 
+#include <PJONDefines.h>
+
 #ifdef ARDUINO
   #include <interfaces/ARDUINO/TCPHelper_ARDUINO.h>
 #else
@@ -156,8 +158,9 @@
 #define ETCP_DEFAULT_PORT                 7000
 
 /* The maximum packet size to be transferred, this protects again buffer overflow.
-   Set this to a size that is guaranteed to be available in RAM during runtime,
-   depending on the hardware and software. */
+   Each link reserves a receive buffer of this size, so incoming packets do not
+   require heap allocations. Set this to a size that is guaranteed to be
+   available in RAM during runtime, depending on the hardware and software. */
 #ifndef ETCP_MAX_PACKET_SIZE
   #define ETCP_MAX_PACKET_SIZE             300
 #endif
@@ -202,16 +205,6 @@ typedef void (*link_error)(
   uint8_t data
 );
 
-class TmpBuffer {
-    char *buf = NULL;
-    uint16_t len = 0;
-  public:
-    TmpBuffer(uint16_t size) { len = size;  buf = new char[size]; }
-    ~TmpBuffer() { if (buf) delete buf;  }
-    char* operator()() { return buf; }
-    uint16_t size() { return len; }
-};
-
 class EthernetLink {
 private:
   // ********* Dynamic members ************
@@ -235,6 +228,9 @@ private:
   uint32_t _connection_count = 0;
   uint32_t _last_receive_time = 0;
 
+  // Incoming packets are read here and passed to the receiver
+  uint8_t _receive_buffer[ETCP_MAX_PACKET_SIZE];
+
   // ********* Configuration ************
 
   link_receiver _receiver = NULL;
@@ -381,9 +377,8 @@ public:
       if (content_length > ETCP_MAX_PACKET_SIZE) return PJON_FAIL;
 
       // Read contents and footer
-      TmpBuffer buf(content_length);
       if(ok) {
-        bytes_read = read_bytes(client, (uint8_t*)buf(), content_length);
+        bytes_read = read_bytes(client, _receive_buffer, content_length);
         if((uint32_t)bytes_read != content_length) ok = false;
       }
 
@@ -433,7 +428,7 @@ public:
 
       // Call receiver callback function
       if(ok && !_receive_and_discard && content_length > 0)
-        _receiver(sender_id, (uint8_t*)buf(), content_length, _callback_object);
+        _receiver(sender_id, _receive_buffer, content_length, _callback_object);
 
       if (!ok) disconnect_in();
     }
@@ -746,8 +741,22 @@ public:
     uint8_t id,
     const char *packet,
     uint16_t length
+  ) {
+    const PJON_Packet_Part part = {(const uint8_t*) packet, length};
+    return send(client, id, &part, 1);
+  };
+
+
+  uint16_t send(
+    TCPHelperClient &client,
+    uint8_t id,
+    const PJON_Packet_Part *parts,
+    uint8_t count
   ) {
     // Assume we are connected. Try to deliver the package
+    uint32_t length = 0;
+    for(uint8_t i = 0; i < count; i++) length += parts[i].length;
+    if(count > PJON_PACKET_MAX_PARTS) return PJON_FAIL;
     uint32_t head = htonl(ETCP_HEADER), foot = htonl(ETCP_FOOTER), len = htonl(length);
     uint8_t buf[9];
     memcpy(buf, &head, 4);
@@ -758,16 +767,19 @@ public:
 
     #ifdef HAS_ETHERNETUDP
     bool ok = client.write((uint8_t*) buf, 9) == 9;
-    if(ok) ok = client.write((uint8_t*) packet, length) == length;
+    for(uint8_t i = 0; ok && i < count; i++)
+      ok = client.write(parts[i].data, parts[i].length) == parts[i].length;
     if(ok) ok = client.write((uint8_t*) &foot, 4) == 4;
     #else
-    // On a POSIX capable device we expect to have enough memory to collect all into one buffer
-    // so that it will not be sent as 3 separate packets when TCP_NODELAY is active.
-    TmpBuffer totalbuf(9+length+4);
-    memcpy(totalbuf(), buf, 9);
-    memcpy(&(totalbuf()[9]), packet, length);
-    memcpy(&(totalbuf()[9+length]), &foot, 4);
-    bool ok = client.write((uint8_t*)totalbuf(), 9+length+4) == (9+length+4);
+    // On a POSIX capable device write all with one gather call, so that it
+    // will not be sent as separate packets when TCP_NODELAY is active.
+    PJON_Packet_Part frame[PJON_PACKET_MAX_PARTS + 2];
+    frame[0].data = buf;
+    frame[0].length = 9;
+    for(uint8_t i = 0; i < count; i++) frame[i + 1] = parts[i];
+    frame[count + 1].data = (const uint8_t*) &foot;
+    frame[count + 1].length = 4;
+    bool ok = client.write(frame, count + 2) == (int)(9 + length + 4);
     #endif
     if(ok) client.flush();
     #ifdef ETCP_DEBUG_PRINT
@@ -805,8 +817,8 @@ public:
     TCPHelperClient &client,
     int16_t id,
     bool master,
-    const char *contents,
-    uint16_t length
+    const PJON_Packet_Part *parts,
+    uint8_t count
   ) {
     if(master) { // Creating outgoing connections
       // Connect or check that we are already connected to the correct server
@@ -819,7 +831,7 @@ public:
       // Send singlesocket header and number of outgoing packets
       bool ok = true;
       uint32_t head = htonl(ETCP_SINGLE_SOCKET_HEADER);
-      uint8_t numpackets_out = length > 0 ? 1 : 0;
+      uint8_t numpackets_out = count > 0 ? 1 : 0;
       char buf[5];
       memcpy(buf, &head, 4);
       memcpy(&buf[4], &numpackets_out, 1);
@@ -828,7 +840,7 @@ public:
 
       // Send the packet and read PJON_ACK
       if(ok && numpackets_out > 0) {
-         ok = send(client, id, contents, length) == PJON_ACK;
+         ok = send(client, id, parts, count) == PJON_ACK;
          #ifdef ETCP_DEBUG_PRINT
            Serial.print(F("++++Sent p, ok="));
            Serial.println(ok);
@@ -876,7 +888,7 @@ public:
       #endif
 
       // Return PJON_ACK if successfully sent or received a packet
-      return contents == NULL ? (numpackets_in > 0 ? result : PJON_FAIL) : result;
+      return count == 0 ? (numpackets_in > 0 ? result : PJON_FAIL) : result;
 
     } else { // Receiving incoming connections and packets and request
       if (client && got_receive_timeout()) {
@@ -923,13 +935,13 @@ public:
       }
 
       // Write number of outgoing packets
-      uint8_t numpackets_out = length > 0 ? 1 : 0;
+      uint8_t numpackets_out = count > 0 ? 1 : 0;
       if(ok) ok = client.write((uint8_t*) &numpackets_out, 1) == 1;
       if(ok) client.flush();
 
       // Write outgoing packets if any
       if(ok && numpackets_out > 0) {
-        ok = send(client, id, contents, length) == PJON_ACK;
+        ok = send(client, id, parts, count) == PJON_ACK;
         #ifdef ETCP_DEBUG_PRINT
            Serial.print(F("Sent p, ok="));
            Serial.println(ok);
@@ -966,7 +978,7 @@ public:
 
       // Return PJON_ACK if successfully sent or received a packet
       uint16_t result = ok ? PJON_ACK : PJON_FAIL;
-      return contents == NULL ? (numpackets_in > 0 ? result : PJON_FAIL) : result;
+      return count == 0 ? (numpackets_in > 0 ? result : PJON_FAIL) : result;
     }
     return PJON_FAIL;
   };
@@ -1212,6 +1224,19 @@ public:
     uint8_t id,
     const char *packet,
     uint16_t length,
+    uint32_t timing_us = 0
+  ) {
+    const PJON_Packet_Part part = {(const uint8_t*) packet, length};
+    return send(id, &part, length > 0 ? 1 : 0, timing_us);
+  };
+
+
+  // Send a packet passed in parts without copying them together
+
+  uint16_t send(
+    uint8_t id,
+    const PJON_Packet_Part *parts,
+    uint8_t count,
     uint32_t = 0 // timing_us
   ) {
     // Special algorithm for single-socket transfers
@@ -1221,8 +1246,8 @@ public:
         _server ? _client_in : _client_out,
         id,
         _server ? false : true,
-        packet,
-        length
+        parts,
+        count
       );
       #else
       return PJON_FAIL;
@@ -1238,7 +1263,7 @@ public:
 
     // Send the packet and read PJON_ACK
     uint16_t result = PJON_FAIL;
-    if(connected) result = send(_client_out, id, packet, length);
+    if(connected) result = send(_client_out, id, parts, count);
 
     // Disconnect
     disconnect_out_if_needed(result);
@@ -1267,6 +1292,26 @@ public:
   };
 
 
+  #ifndef HAS_ETHERNETUDP
+  /* File descriptors receive reads from: the listening socket and the
+     incoming connection, or the outgoing connection if it is used to
+     receive too (single socket or both sockets initiated by this side) */
+
+  uint8_t get_fds(int *fds, uint8_t max_fds) {
+    uint8_t count = 0;
+    if(_server && _server->get_fd() != -1 && count < max_fds)
+      fds[count++] = _server->get_fd();
+    if(_client_in && count < max_fds) fds[count++] = _client_in.get_fd();
+    if(
+      _client_out && count < max_fds && _server == NULL && (
+        _single_socket || _initiate_both_sockets_in_same_direction
+      )
+    ) fds[count++] = _client_out.get_fd();
+    return count;
+  };
+  #endif
+
+
   void set_receiver(link_receiver r, void *callback_object) {
     _receiver = r;
     _callback_object = callback_object;
@@ -125,6 +125,15 @@ class EthernetTCP {
     }
 
 
+    #ifndef HAS_ETHERNETUDP
+    /* File descriptors to wait on before receiving (used by PJON_Reactor): */
+
+    uint8_t get_fds(int *fds, uint8_t max_fds) {
+      return link.get_fds(fds, max_fds);
+    };
+    #endif
+
+
     /* Receive byte response */
 
     uint16_t receive_response() {
@@ -145,4 +154,12 @@ class EthernetTCP {
         last_send_result =
           link.send((uint8_t)string[0], (const char*)string, length);
     };
+
+
+    /* Send a string passed in parts: */
+
+    void send_string(const PJON_Packet_Part *parts, uint8_t count) {
+      if(count && parts[0].length > 0)
+        last_send_result = link.send(parts[0].data[0], parts, count);
+    };
 };
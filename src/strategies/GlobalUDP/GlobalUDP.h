@@ -34,10 +34,23 @@
   #define GUDP_RESPONSE_TIMEOUT         100000ul
 #endif
 
+/* Maximum number of remote nodes (up to 255), the default is low on
+   microcontrollers to save memory */
 #ifndef GUDP_MAX_REMOTE_NODES
-  #define GUDP_MAX_REMOTE_NODES               10
+  #if defined(LINUX) || defined(RPI) || defined(_WIN32)
+    #define GUDP_MAX_REMOTE_NODES            255
+  #else
+    #define GUDP_MAX_REMOTE_NODES             10
+  #endif
 #endif
 
+/* Nodes are found through a linear probing hash table of their slots, its
+   length is at least 256 if GUDP_MAX_REMOTE_NODES is greater than 127, so
+   that device ids of the local bus never collide */
+#define GUDP_NODE_TABLE \
+  PJONTools::hash_table_length(GUDP_MAX_REMOTE_NODES)
+#define GUDP_NODE_NONE                      0xFF
+
 #define GUDP_DEFAULT_PORT                    7000
 #define GUDP_MAGIC_HEADER   (uint32_t) 0x0DFAC3FF
 
@@ -45,12 +58,18 @@ class GlobalUDP {
     bool _udp_initialized = false;
     uint16_t _port = GUDP_DEFAULT_PORT;
     bool _auto_registration = true;
+    uint32_t _idle_timeout = 0;
+    const uint8_t _localhost[4] = {0, 0, 0, 0};
 
-    // Remote nodes
+    // Remote nodes, bus id 0.0.0.0 if registered for any bus
     uint8_t  _remote_node_count = 0;
     uint8_t  _remote_id[GUDP_MAX_REMOTE_NODES];
+    uint8_t  _remote_bus_id[GUDP_MAX_REMOTE_NODES][4];
     uint8_t  _remote_ip[GUDP_MAX_REMOTE_NODES][4];
     uint16_t _remote_port[GUDP_MAX_REMOTE_NODES];
+    uint32_t _remote_seen[GUDP_MAX_REMOTE_NODES];
+    bool     _remote_auto[GUDP_MAX_REMOTE_NODES];
+    uint8_t  _node_table[GUDP_NODE_TABLE];
 
     UDPHelper udp;
 
@@ -62,11 +81,124 @@ class GlobalUDP {
       return _udp_initialized;
     };
 
-    int16_t find_remote_node(uint8_t id) {
-      for(uint8_t i = 0; i < _remote_node_count; i++)
-        if(_remote_id[i] == id)
-          return i;
-      return -1;
+    /* Check if a node registered before n has the same address, so that
+       a device registered for more bus ids receives a broadcast once: */
+
+    bool duplicate_address(uint8_t n) const {
+      for(uint8_t m = 0; m < n; m++)
+        if(
+          _remote_port[m] == _remote_port[n] &&
+          !memcmp(_remote_ip[m], _remote_ip[n], 4)
+        ) return true;
+      return false;
+    };
+
+    static bool any_bus(const uint8_t *bus_id) {
+      return !(bus_id[0] | bus_id[1] | bus_id[2] | bus_id[3]);
+    };
+
+    static uint16_t node_hash(uint8_t id, const uint8_t *bus_id) {
+      if(any_bus(bus_id)) return id & (GUDP_NODE_TABLE - 1);
+      uint32_t hash = id;
+      for(uint8_t i = 0; i < 4; i++)
+        hash = (hash ^ bus_id[i]) * 16777619;
+      hash *= 2654435769UL;
+      return (hash ^ (hash >> 16)) & (GUDP_NODE_TABLE - 1);
+    };
+
+    /* Position in the table of the node, or of the empty entry ending its
+       cluster if the node is not registered: */
+
+    uint16_t node_position(uint8_t id, const uint8_t *bus_id) const {
+      uint16_t position = node_hash(id, bus_id);
+      for(
+        uint8_t n;
+        (n = _node_table[position]) != GUDP_NODE_NONE;
+        position = (position + 1) & (GUDP_NODE_TABLE - 1)
+      ) if(
+        _remote_id[n] == id &&
+        PJONTools::bus_id_equality(_remote_bus_id[n], bus_id)
+      ) break;
+      return position;
+    };
+
+    /* The node of the receiver, registered for its bus or for any bus: */
+
+    int16_t find_remote_node(uint8_t id, const uint8_t *bus_id) const {
+      uint8_t n = _node_table[node_position(id, bus_id)];
+      if(n == GUDP_NODE_NONE && !any_bus(bus_id))
+        n = _node_table[node_position(id, _localhost)];
+      return n == GUDP_NODE_NONE ? -1 : n;
+    };
+
+    int16_t insert_node(
+      uint8_t id,
+      const uint8_t *bus_id,
+      const uint8_t *ip,
+      uint16_t port,
+      bool autoregistered
+    ) {
+      uint16_t position = node_position(id, bus_id);
+      uint8_t n = _node_table[position];
+      if(n == GUDP_NODE_NONE) {
+        if(_remote_node_count == GUDP_MAX_REMOTE_NODES) {
+          if(!evict_idle_node()) return -1;
+          position = node_position(id, bus_id);
+        }
+        n = _remote_node_count++;
+        _node_table[position] = n;
+        _remote_id[n] = id;
+        PJONTools::copy_bus_id(_remote_bus_id[n], bus_id);
+      }
+      memcpy(_remote_ip[n], ip, 4);
+      _remote_port[n] = port;
+      _remote_seen[n] = PJON_MILLIS();
+      _remote_auto[n] = autoregistered;
+      return n;
+    };
+
+    /* Remove the node n from the table shifting back the nodes following it
+       in the same cluster, then move the last node in its slot: */
+
+    void remove_slot(uint8_t n) {
+      const uint16_t mask = GUDP_NODE_TABLE - 1;
+      uint16_t hole = node_position(_remote_id[n], _remote_bus_id[n]);
+      for(uint16_t next = (hole + 1) & mask; ; next = (next + 1) & mask) {
+        uint8_t m = _node_table[next];
+        if(m == GUDP_NODE_NONE) break;
+        uint16_t home = node_hash(_remote_id[m], _remote_bus_id[m]);
+        // Skip nodes whose home is between the hole and their position
+        if(((next - home) & mask) < ((next - hole) & mask)) continue;
+        _node_table[hole] = m;
+        hole = next;
+      }
+      _node_table[hole] = GUDP_NODE_NONE;
+      uint8_t last = --_remote_node_count;
+      if(n == last) return;
+      _node_table[node_position(_remote_id[last], _remote_bus_id[last])] = n;
+      _remote_id[n] = _remote_id[last];
+      PJONTools::copy_bus_id(_remote_bus_id[n], _remote_bus_id[last]);
+      memcpy(_remote_ip[n], _remote_ip[last], 4);
+      _remote_port[n] = _remote_port[last];
+      _remote_seen[n] = _remote_seen[last];
+      _remote_auto[n] = _remote_auto[last];
+    };
+
+    /* Make room removing the autoregistered node idle for the longest time,
+       if idle for at least the idle timeout: */
+
+    bool evict_idle_node() {
+      if(!_idle_timeout) return false;
+      uint32_t now = PJON_MILLIS(), idle = 0;
+      int16_t oldest = -1;
+      for(uint8_t n = 0; n < _remote_node_count; n++)
+        if(_remote_auto[n] && (uint32_t)(now - _remote_seen[n]) >= idle) {
+          idle = now - _remote_seen[n];
+          oldest = n;
+        }
+      if(oldest == -1 || idle < _idle_timeout) return false;
+      remove_slot(oldest);
+      return true;
     };
 
     void autoregister_sender(const uint8_t *message, uint16_t length) {
@@ -83,32 +215,97 @@ class GlobalUDP {
         uint16_t sender_port;
         udp.get_sender(sender_ip, sender_port);
 
-        // See if PJON id is already registered, add if not
-        int16_t pos = find_remote_node(sender_id);
-        if (pos == -1) add_node(sender_id, sender_ip, sender_port);
+        // Register the sender, or update its IP, port and last seen time
+        int16_t n = find_remote_node(sender_id, packet_info.sender_bus_id);
+        if(n == -1)
+          insert_node(
+            sender_id,
+            packet_info.sender_bus_id,
+            sender_ip,
+            sender_port,
+            true
+          );
         else {
-          // Update IP and port of existing node
-          memcpy(_remote_ip[pos], sender_ip, 4);
-          _remote_port[pos] = sender_port; 
+          memcpy(_remote_ip[n], sender_ip, 4);
+          _remote_port[n] = sender_port;
+          _remote_seen[n] = PJON_MILLIS();
         }
       }
     }
 
 public:
+    GlobalUDP() {
+      memset(_node_table, GUDP_NODE_NONE, sizeof(_node_table));
+    };
 
-    /* Register each device we want to send to */
+
+    /* Register each device we want to send to, optionally only for the
+       packets sent to its bus id (returns -1 if the table is full): */
 
     int16_t add_node(
       uint8_t remote_id,
       const uint8_t remote_ip[],
       uint16_t port_number = GUDP_DEFAULT_PORT
     ) {
-      if (_remote_node_count == GUDP_MAX_REMOTE_NODES) return -1;
-      _remote_id[_remote_node_count] = remote_id;
-      memcpy(_remote_ip[_remote_node_count], remote_ip, 4);
-      _remote_port[_remote_node_count] = port_number;
-      _remote_node_count++;
-      return _remote_node_count - 1;
+      return insert_node(
+        remote_id,
+        _localhost,
+        remote_ip,
+        port_number,
+        false
+      );
+    };
+
+    int16_t add_node(
+      uint8_t remote_id,
+      const uint8_t remote_bus_id[],
+      const uint8_t remote_ip[],
+      uint16_t port_number
+    ) {
+      return insert_node(
+        remote_id,
+        remote_bus_id,
+        remote_ip,
+        port_number,
+        false
+      );
+    };
+
+
+    /* Remove a registered device (returns false if not registered): */
+
+    bool remove_node(uint8_t remote_id, const uint8_t *remote_bus_id = NULL) {
+      uint8_t n = _node_table[node_position(
+        remote_id,
+        remote_bus_id ? remote_bus_id : _localhost
+      )];
+      if(n == GUDP_NODE_NONE) return false;
+      remove_slot(n);
+      return true;
+    };
+
+
+    /* Milliseconds since a packet was last received from a registered
+       device, or since it was registered (0xFFFFFFFF if not registered): */
+
+    uint32_t get_node_idle_time(
+      uint8_t remote_id,
+      const uint8_t *remote_bus_id = NULL
+    ) const {
+      uint8_t n = _node_table[node_position(
+        remote_id,
+        remote_bus_id ? remote_bus_id : _localhost
+      )];
+      if(n == GUDP_NODE_NONE) return 0xFFFFFFFF;
+      return PJON_MILLIS() - _remote_seen[n];
+    };
+
+
+    /* Autoregistered devices idle for at least timeout milliseconds are
+       replaced when the table is full (0, the default, never replaces): */
+
+    void set_idle_timeout(uint32_t timeout) {
+      _idle_timeout = timeout;
     };
 
 
@@ -197,15 +394,79 @@ public:
     /* Send a string: */
 
     void send_string(uint8_t *string, uint16_t length) {
-      if(length > 0) {
-        uint8_t id = string[0]; // Package always starts with a receiver id
+      const PJON_Packet_Part part = {string, length};
+      send_string(&part, 1);
+    };
+
+
+    /* Filter in the kernel the datagrams not addressed to this device, so
+       they do not wake up the process (Linux only, disabled by default): */
+
+    void set_filter(bool enabled) {
+      udp.set_filter(enabled);
+    };
+
+
+    /* Set the receiver id accepted by the filter (called by PJON): */
+
+    void set_receiver_id(uint8_t id, bool router) {
+      udp.set_receiver_id(id, router);
+    };
+
+
+    #ifndef HAS_ETHERNETUDP
+    /* File descriptors to wait on before receiving (used by PJON_Reactor): */
+
+    uint8_t get_fds(int *fds, uint8_t max_fds) {
+      return udp.get_fds(fds, max_fds);
+    };
+
+
+    /* Number of socket calls made to send and receive, for benchmarking: */
+
+    uint32_t get_syscall_count() const { return udp.get_syscall_count(); };
+    #endif
+
+
+    /* Batch slots receive datagrams of up to UDP_BATCH_FRAME_LENGTH bytes,
+       including the 4 bytes magic header: */
+
+    #if(UDP_BATCH)
+      static const uint16_t max_frame_length = UDP_BATCH_FRAME_LENGTH - 4;
+    #endif
+
+
+    /* Send the datagrams queued with UDP_BATCH_SIZE > 1: */
+
+    void flush() {
+      udp.flush();
+    };
+
+
+    /* Send a string passed in parts: */
+
+    void send_string(const PJON_Packet_Part *parts, uint8_t count) {
+      if(count && parts[0].length > 1) {
+        const uint8_t *packet = parts[0].data;
+        uint8_t id = packet[0]; // Receiver id is always first
         if (id == 0) { // Broadcast, send to all receivers
           for(uint8_t pos = 0; pos < _remote_node_count; pos++)
-            udp.send_string(string, length, _remote_ip[pos], _remote_port[pos]);
+            if(!duplicate_address(pos))
+              udp.send_string(
+                parts,
+                count,
+                _remote_ip[pos],
+                _remote_port[pos]
+              );
         } else { // To a specific receiver
-          int16_t pos = find_remote_node(id);
+          int16_t pos = find_remote_node(
+            id,
+            (packet[1] & PJON_MODE_BIT) ?
+              packet + PJONTools::bus_id_offset(packet[1]) :
+              _localhost
+          );
           if (pos != -1) {
-            udp.send_string(string, length, _remote_ip[pos], _remote_port[pos]);
+            udp.send_string(parts, count, _remote_ip[pos], _remote_port[pos]);
           }
         }
       }
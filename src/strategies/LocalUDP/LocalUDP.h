@@ -34,19 +34,75 @@
 #endif
 #define LUDP_MAGIC_HEADER        (uint32_t) 0x0DFAC3D0
 
+/* Maximum number of bus ids sent to their own multicast group: */
+#ifndef LUDP_MAX_GROUPS
+  #define LUDP_MAX_GROUPS 4
+#endif
+
+struct LUDP_Group {
+  uint8_t bus_id[4];
+  uint8_t ip[4];
+  bool join;
+};
+
 class LocalUDP {
     bool _udp_initialized = false;
     uint16_t _port = LUDP_DEFAULT_PORT;
     UDPHelper udp;
 
+    bool _multicast = false;
+    bool _loopback = true;
+    uint8_t _ttl = 1;
+    uint8_t _group[4];
+    uint8_t _interface[4];
+    bool _interface_set = false;
+    LUDP_Group _groups[LUDP_MAX_GROUPS];
+    uint8_t _group_count = 0;
+
     bool check_udp() {
       if(!_udp_initialized) {
         udp.set_magic_header(htonl(LUDP_MAGIC_HEADER));
-        if (udp.begin(_port)) _udp_initialized = true;
+        udp.set_reuse_address(_multicast);
+        if(udp.begin(_port) && (!_multicast || join_groups()))
+          _udp_initialized = true;
       }
       return _udp_initialized;
     };
 
+    /* Join the default group and the groups of the buses the device
+       participates in, each group once: */
+
+    bool join_groups() {
+      if(!udp.set_multicast_options(
+        _ttl,
+        _loopback,
+        _interface_set ? _interface : NULL
+      )) return false;
+      if(!udp.join_group(_group)) return false;
+      for(uint8_t i = 0; i < _group_count; i++) {
+        if(!_groups[i].join) continue;
+        bool joined = PJONTools::bus_id_equality(_groups[i].ip, _group);
+        for(uint8_t j = 0; (j < i) && !joined; j++)
+          joined = _groups[j].join &&
+            PJONTools::bus_id_equality(_groups[i].ip, _groups[j].ip);
+        if(!joined && !udp.join_group(_groups[i].ip)) return false;
+      }
+      return true;
+    };
+
+    /* The group of the packet's receiver bus id, or the default group: */
+
+    uint8_t *group_of(const uint8_t *packet) {
+      if(packet[1] & PJON_MODE_BIT) {
+        const uint8_t *bus_id =
+          packet + PJONTools::bus_id_offset(packet[1]);
+        for(uint8_t i = 0; i < _group_count; i++)
+          if(PJONTools::bus_id_equality(_groups[i].bus_id, bus_id))
+            return _groups[i].ip;
+      }
+      return _group;
+    };
+
 public:
     /* Returns the suggested delay related to the attempts passed as parameter: */
 
@@ -123,7 +179,98 @@ public:
     /* Send a string: */
 
     void send_string(uint8_t *string, uint16_t length) {
-      udp.send_string(string, length);
+      const PJON_Packet_Part part = {string, length};
+      send_string(&part, 1);
+    };
+
+
+    /* Filter in the kernel the datagrams not addressed to this device, so
+       they do not wake up the process (Linux only, disabled by default): */
+
+    void set_filter(bool enabled) {
+      udp.set_filter(enabled);
+    };
+
+
+    /* Set the receiver id accepted by the filter (called by PJON): */
+
+    void set_receiver_id(uint8_t id, bool router) {
+      udp.set_receiver_id(id, router);
+    };
+
+
+    #ifndef HAS_ETHERNETUDP
+    /* File descriptors to wait on before receiving (used by PJON_Reactor): */
+
+    uint8_t get_fds(int *fds, uint8_t max_fds) {
+      return udp.get_fds(fds, max_fds);
+    };
+    #endif
+
+
+    /* Batch slots receive datagrams of up to UDP_BATCH_FRAME_LENGTH bytes,
+       including the 4 bytes magic header: */
+
+    #if(UDP_BATCH)
+      static const uint16_t max_frame_length = UDP_BATCH_FRAME_LENGTH - 4;
+    #endif
+
+
+    /* Send the datagrams queued with UDP_BATCH_SIZE > 1: */
+
+    void flush() {
+      udp.flush();
+    };
+
+
+    /* Send a string passed in parts: */
+
+    void send_string(const PJON_Packet_Part *parts, uint8_t count) {
+      if(_multicast && count && (parts[0].length > 1))
+        udp.send_string(parts, count, group_of(parts[0].data), _port);
+      else udp.send_string(parts, count);
+    };
+
+
+    /* Send to a multicast group instead of broadcasting, so that only the
+       hosts that joined the group receive the packets. A TTL of 1 keeps the
+       packets in the LAN, loopback delivers them to the other processes on
+       the same host, interface_ip selects the network interface (if NULL
+       it is chosen by the system): */
+
+    void set_multicast(
+      const uint8_t *group_ip,
+      uint8_t ttl = 1,
+      bool loopback = true,
+      const uint8_t *interface_ip = NULL
+    ) {
+      memcpy(_group, group_ip, 4);
+      _ttl = ttl;
+      _loopback = loopback;
+      _interface_set = interface_ip;
+      if(_interface_set) memcpy(_interface, interface_ip, 4);
+      _multicast = true;
+      udp.flush();
+      _udp_initialized = false;
+    };
+
+
+    /* Send the packets addressed to bus_id to its own multicast group, join
+       the group if the device participates in the bus
+       (returns false if LUDP_MAX_GROUPS buses are already mapped): */
+
+    bool add_bus_group(
+      const uint8_t *bus_id,
+      const uint8_t *group_ip,
+      bool join = true
+    ) {
+      if(_group_count >= LUDP_MAX_GROUPS) return false;
+      PJONTools::copy_bus_id(_groups[_group_count].bus_id, bus_id);
+      memcpy(_groups[_group_count].ip, group_ip, 4);
+      _groups[_group_count++].join = join;
+      udp.flush();
+      _udp_initialized = false;
+      return true;
     };
 
 
@@ -154,7 +154,10 @@ class OverSampling {
 
     uint16_t receive_string(uint8_t *string, uint16_t max_length) {
       uint16_t result;
-      if(max_length == PJON_PACKET_MAX_LENGTH) {
+      // A max_length not shorter than the previous one starts a new packet
+      bool start = (max_length >= _max_length);
+      _max_length = max_length;
+      if(start) {
         uint32_t time = PJON_MICROS();
         // Look for string initializer
         if(!sync() || !sync() || !sync()) return OS_FAIL;
@@ -293,6 +296,7 @@ class OverSampling {
     };
 
   private:
+    uint16_t _max_length = 0;
     uint8_t _input_pin;
     uint8_t _output_pin;
 };
@@ -160,7 +160,10 @@ class SoftwareBitBang {
 
     uint16_t receive_string(uint8_t *string, uint16_t max_length) {
       uint16_t result;
-      if(max_length == PJON_PACKET_MAX_LENGTH) {
+      // Each call receiving the same packet passes a shorter max_length
+      bool start = (max_length >= _max_length);
+      _max_length = max_length;
+      if(start) {
         uint32_t time = PJON_MICROS();
         // Look for a frame initializer
         if(!sync() || !sync() || !sync()) return SWBB_FAIL;
@@ -323,6 +326,7 @@ class SoftwareBitBang {
     };
 
   private:
+    uint16_t _max_length = 0;
     uint8_t _input_pin;
     uint8_t _output_pin;
 };
@@ -129,8 +129,12 @@ class ThroughSerial {
 
     uint16_t receive_string(uint8_t *string, uint16_t max_length) {
       uint16_t result;
+      /* The max_length passed is shorter at each call of the same reception,
+         the first call of a new one expects TS_START: */
+      bool start = (max_length >= _max_length);
+      _max_length = max_length;
       // No initial flag, byte-stuffing violation
-      if(max_length == PJON_PACKET_MAX_LENGTH)
+      if(start)
         if(
           (receive_byte() != TS_START) ||
           (_last_byte == TS_ESC)
@@ -158,6 +162,31 @@ class ThroughSerial {
     };
 
 
+    /* Receive a whole frame removing byte-stuffing, returns PJON_ACK and
+       its length in length or TS_FAIL: */
+
+    uint16_t receive_frame(uint8_t *frame, uint16_t max, uint16_t &length) {
+      length = 0;
+      if(receive_byte() != TS_START) return TS_FAIL;
+      while(true) {
+        uint16_t result = receive_byte();
+        // Unescaped START byte stuffing violation
+        if((result == TS_FAIL) || (result == TS_START)) return TS_FAIL;
+        if(result == TS_END) return length ? PJON_ACK : TS_FAIL;
+        if(result == TS_ESC) {
+          result = receive_byte();
+          if(result == TS_FAIL) return TS_FAIL;
+          result ^= TS_ESC;
+          // Avoid byte-stuffing violation
+          if((result != TS_START) && (result != TS_ESC) && (result != TS_END))
+            return TS_FAIL;
+        }
+        if(length == max) return TS_FAIL;
+        frame[length++] = result;
+      }
+    };
+
+
     /* Send a byte and wait for its transmission end */
 
     void send_byte(uint8_t b) {
@@ -170,7 +199,11 @@ class ThroughSerial {
       start_tx();
       wait_RS485_pin_change();
       send_byte(response);
-      PJON_SERIAL_FLUSH(serial);
+      #ifdef PJON_SERIAL_DRAIN
+        PJON_SERIAL_DRAIN(serial);
+      #else
+        PJON_SERIAL_FLUSH(serial);
+      #endif
       wait_RS485_pin_change();
       end_tx();
     };
@@ -180,6 +213,28 @@ class ThroughSerial {
 
     void send_string(uint8_t *string, uint8_t length) {
       start_tx();
+    #if defined(PJON_SERIAL_WRITE_STRING) && defined(PJON_SERIAL_DRAIN)
+      /* Byte-stuff the frame, write it at once and wait until it is
+         transmitted, so that RS485 pins are released as soon as possible.
+         PJON_SERIAL_FLUSH is not called, on Linux it would discard data
+         the other side may not have read yet */
+      uint8_t frame[2 + (2 * 255)];
+      uint16_t frame_length = 0;
+      frame[frame_length++] = TS_START;
+      for(uint8_t b = 0; b < length; b++) {
+        if(
+          (string[b] == TS_START) ||
+          (string[b] == TS_ESC) ||
+          (string[b] == TS_END)
+        ) {
+          frame[frame_length++] = TS_ESC;
+          frame[frame_length++] = string[b] ^ TS_ESC;
+        } else frame[frame_length++] = string[b];
+      }
+      frame[frame_length++] = TS_END;
+      PJON_SERIAL_WRITE_STRING(serial, frame, frame_length);
+      PJON_SERIAL_DRAIN(serial);
+    #else
       uint16_t overhead = 2;
       // Add frame flag
       send_byte(TS_START);
@@ -205,6 +260,7 @@ class ThroughSerial {
           );
       #endif
       PJON_SERIAL_FLUSH(serial);
+    #endif
       end_tx();
     };
 
@@ -215,6 +271,20 @@ class ThroughSerial {
       serial = serial_port;
     };
 
+    #if defined(LINUX) || defined(RPI)
+    /* File descriptor to wait on before receiving (used by PJON_Reactor): */
+
+    uint8_t get_fds(int *fds, uint8_t max_fds) {
+      if(serial < 0 || !max_fds) return 0;
+      #ifdef PJON_SERIAL_BUFFERED
+        // Bytes already read from the port do not wake epoll up
+        if(PJON_SERIAL_BUFFERED(serial)) return PJON_FDS_PENDING;
+      #endif
+      fds[0] = serial;
+      return 1;
+    };
+    #endif
+
     void wait_RS485_pin_change() {
       if(_enable_RS485_txe_pin != TS_NOT_ASSIGNED)
         PJON_DELAY(_RS485_delay);
@@ -241,8 +311,8 @@ class ThroughSerial {
     };
 
   #if defined(RPI) || defined(LINUX)
-    /* Pass baudrate to ThroughSerial
-       (needed only for RPI flush hack): */
+    /* Pass baudrate to ThroughSerial (needed only for RPI flush hack,
+       not used if PJON_SERIAL_DRAIN is defined): */
 
     void set_baud_rate(uint32_t baud) {
       _bd = baud;
@@ -281,6 +351,7 @@ class ThroughSerial {
     uint16_t _flush_offset = TS_FLUSH_OFFSET;
     uint32_t _bd;
   #endif
+    uint16_t _max_length = 0;
     uint8_t  _last_byte;
     uint32_t _last_reception_time;
     uint8_t  _enable_RS485_rxe_pin = TS_NOT_ASSIGNED;
@@ -1,4 +1,3 @@
-
 #pragma once
 
 /* Compute CRC8 with a table-less implementation:
@@ -7,22 +6,85 @@
    CRC8 C2, source Baicheva98 (implicit + 1 notation)
    0x97 = (x + 1)(x^7 + x^6 + x^5 + x^2 + 1)^2
    Chosen because it has the largest possible length (119 bit) at which
-   HD=4 can be achieved with 8-bit CRC. */
+   HD=4 can be achieved with 8-bit CRC.
+
+   Implementation selection, define PJON_CRC8_MODE before including PJON:
+
+   PJON_CRC8_BITWISE  Table-less, 8 shift/xor iterations per byte
+                      (default on microcontrollers)
+   PJON_CRC8_TABLE    256 bytes lookup table generated at compile time,
+                      stored in PROGMEM on AVR (default on LINUX, RPI and
+                      WINX86) */
+
+#define PJON_CRC8_BITWISE 0
+#define PJON_CRC8_TABLE   1
+
+#ifndef PJON_CRC8_MODE
+  #if defined(LINUX) || defined(RPI) || defined(_WIN32)
+    #define PJON_CRC8_MODE PJON_CRC8_TABLE
+  #else
+    #define PJON_CRC8_MODE PJON_CRC8_BITWISE
+  #endif
+#endif
+
+#if(PJON_CRC8_MODE == PJON_CRC8_TABLE)
+  #if defined(__AVR__)
+    #include <avr/pgmspace.h>
+    #define PJON_CRC8_PROGMEM PROGMEM
+    #define PJON_CRC8_READ(E) pgm_read_byte(&(E))
+  #else
+    #define PJON_CRC8_PROGMEM
+    #define PJON_CRC8_READ(E) (E)
+  #endif
+
+  /* Entry i is the CRC of the byte i starting from 0, so that rolling a byte
+     is crc = table[crc ^ byte] */
+
+  constexpr uint8_t PJON_crc8_bits(uint8_t crc, uint8_t bits) {
+    return bits ?
+      PJON_crc8_bits((crc >> 1) ^ ((crc & 1) ? 0x97 : 0), bits - 1) : crc;
+  };
+
+  #define PJON_CRC8_T4(I) \
+    PJON_crc8_bits(I, 8), PJON_crc8_bits(I + 1, 8), \
+    PJON_crc8_bits(I + 2, 8), PJON_crc8_bits(I + 3, 8)
+  #define PJON_CRC8_T16(I) \
+    PJON_CRC8_T4(I), PJON_CRC8_T4(I + 4), \
+    PJON_CRC8_T4(I + 8), PJON_CRC8_T4(I + 12)
+  #define PJON_CRC8_T64(I) \
+    PJON_CRC8_T16(I), PJON_CRC8_T16(I + 16), \
+    PJON_CRC8_T16(I + 32), PJON_CRC8_T16(I + 48)
+
+  static const uint8_t PJON_crc8_table[256] PJON_CRC8_PROGMEM = {
+    PJON_CRC8_T64(0), PJON_CRC8_T64(64),
+    PJON_CRC8_T64(128), PJON_CRC8_T64(192)
+  };
+#endif
 
 struct PJON_crc8 {
 
   static inline uint8_t roll(uint8_t input_byte, uint8_t crc) {
-    for(uint8_t i = 8; i; i--, input_byte >>= 1) {
-      uint8_t result = (crc ^ input_byte) & 0x01;
-      crc >>= 1;
-      if(result) crc ^= 0x97;
-    }
-    return crc;
+    #if(PJON_CRC8_MODE == PJON_CRC8_TABLE)
+      return PJON_CRC8_READ(PJON_crc8_table[crc ^ input_byte]);
+    #else
+      for(uint8_t i = 8; i; i--, input_byte >>= 1) {
+        uint8_t result = (crc ^ input_byte) & 0x01;
+        crc >>= 1;
+        if(result) crc ^= 0x97;
+      }
+      return crc;
+    #endif
   };
 
 
-  static inline uint8_t compute(const uint8_t *input_byte, uint16_t length) {
-    uint8_t crc = 0;
+  /* Compute the CRC of length bytes, pass the CRC previously computed to
+     continue the computation incrementally as data is received: */
+
+  static inline uint8_t compute(
+    const uint8_t *input_byte,
+    uint16_t length,
+    uint8_t crc = 0
+  ) {
     for(uint16_t b = 0; b < length; b++)
       crc = roll(input_byte[b], crc);
     return crc;